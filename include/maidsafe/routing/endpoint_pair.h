@@ -55,6 +55,11 @@ inline bool operator==(const EndpointPair& lhs, const EndpointPair& rhs) {
   return lhs.local == rhs.local && lhs.external == rhs.external;
 }
 
+// False for a default-constructed pair, i.e. if we don't know where the node can be reached.
+inline bool IsSet(const EndpointPair& ep) {
+  return ep.local.port() != 0 || ep.external.port() != 0;
+}
+
 #ifndef NDEBUG
 inline std::ostream& operator<<(std::ostream& os, const EndpointPair& ep) {
   return os << "(local: " << ep.local << "; external: " << ep.external << ")";
@@ -27,13 +27,13 @@
 #include <vector>
 
 #include "asio/io_service.hpp"
-#include "asio/post.hpp"
 #include "asio/use_future.hpp"
 #include "asio/ip/udp.hpp"
+#include "boost/asio/steady_timer.hpp"
 #include "boost/filesystem/path.hpp"
 #include "boost/expected/expected.hpp"
 
-#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/convert.h"
 #include "maidsafe/common/types.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/containers/lru_cache.h"
@@ -43,9 +43,13 @@
 
 #include "maidsafe/routing/bootstrap_handler.h"
 #include "maidsafe/routing/connection_manager.h"
+#include "maidsafe/routing/message_buffers.h"
 #include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/message_view.h"
 #include "maidsafe/routing/messages/messages.h"
 #include "maidsafe/routing/endpoint_pair.h"
+#include "maidsafe/routing/io_shards.h"
+#include "maidsafe/routing/peer_snapshot.h"
 #include "maidsafe/routing/sentinel.h"
 #include "maidsafe/routing/types.h"
 
@@ -53,44 +57,83 @@ namespace maidsafe {
 
 namespace routing {
 
+namespace test {
+struct RoutingNodeAccess;
+}  // namespace test
+
 template <typename Child>
 class RoutingNode {
  private:
   using SendHandler = std::function<void(asio::error_code)>;
 
  public:
+  // Socket I/O is spread over 'IoShards::DefaultCount()' threads, or over 'io_shard_count' threads
+  // if given.  The routing logic itself runs on the first of these (see 'IoShards').
   RoutingNode();
+  explicit RoutingNode(size_t io_shard_count);
   RoutingNode(const RoutingNode&) = delete;
   RoutingNode(RoutingNode&&) = delete;
   RoutingNode& operator=(const RoutingNode&) = delete;
   RoutingNode& operator=(RoutingNode&&) = delete;
   ~RoutingNode();
 
+  // 'Get', 'Put' and 'Post' may be called from any thread; the request is sent from the control
+  // shard, as the peers may only be touched there.
   // // will return with the data
   template <typename CompletionToken>
   GetReturn<CompletionToken> Get(Data::NameAndTypeId name_and_type_id, CompletionToken token);
-  // will return with allowed or not (error_code only)
+  // Completes once the message has been queued to the targets, or with 'host_unreachable' if we
+  // have none.  TODO(Team): complete with allowed or not once Put responses are handled.
   template <typename DataType, typename CompletionToken>
   PutReturn<CompletionToken> Put(Address to, DataType data, CompletionToken token);
   // will return with allowed or not (error_code only)
   template <typename FunctorType, typename CompletionToken>
   PostReturn<CompletionToken> Post(Address to, FunctorType functor, CompletionToken token);
 
-  void AddBootstrapContact(crux::endpoint /*endpoint*/) {
-    // bootstrap_handler_.AddBootstrapContact(endpoint);
+  // Bootstrap contacts are only connected to if we can't reconnect to any peer from our snapshot.
+  void AddBootstrapContact(crux::endpoint endpoint) {
+    io_shards_.Control().Post([=]() { bootstrap_contacts_.push_back(endpoint); });
   }
 
+  // Reconnects in parallel to the peers recorded in the snapshot at 'path', falling back to the
+  // bootstrap contacts if none of them can be reached.  From then on, the snapshot is rewritten
+  // every 'SnapshotInterval()' and on shutdown.
+  void StartFromSnapshot(boost::filesystem::path path);
+
   void AddContact(asio::ip::udp::endpoint endpoint) {
-    crux_asio_service_.service().post(
+    io_shards_.Control().Post(
         [=]() { connection_manager_.AddNode(boost::none, EndpointPair(endpoint)); });
   }
 
   void StartAccepting(unsigned short port) {
-    crux_asio_service_.service().post([=]() { connection_manager_.StartAccepting(port); });
+    io_shards_.Control().Post([=]() { connection_manager_.StartAccepting(port); });
+  }
+
+  // Coalesces small messages to each peer into batch frames.  Only enable this once every node on
+  // the network can unpack batch frames.
+  void EnableBatching(BatchingOptions options = PeerNode::DefaultBatchingOptions()) {
+    io_shards_.Control().Post([=]() { connection_manager_.EnableBatching(options); });
+  }
+
+  // Sends the messages we originate (requests and responses, not those we forward) with compact
+  // headers (see 'SerialiseCompactHeader').  Only enable this once every node on the network can
+  // read compact headers.
+  void EnableCompactHeaders() {
+    io_shards_.Control().Post([=]() { header_encoding_ = HeaderEncoding::compact; });
   }
 
   void Shutdown() {
-    crux_asio_service_.service().post([=]() { connection_manager_.Shutdown(); });
+    io_shards_.Control().Post([=]() {
+      snapshot_timer_.cancel();
+      WriteSnapshot();
+      connection_manager_.Shutdown();
+    });
+  }
+
+  static std::chrono::steady_clock::duration SnapshotInterval() { return std::chrono::minutes(5); }
+  // Changes to our close group are passed to the child's 'HandleChurn' at most once per window.
+  static std::chrono::steady_clock::duration CloseGroupChangeWindow() {
+    return std::chrono::milliseconds(500);
   }
 
  private:
@@ -117,10 +160,13 @@ class RoutingNode {
   // filling in public key again.
   void HandleMessage(routing::Post post, MessageHeader original_header);
   bool TryCache(MessageTypeTag tag, MessageHeader header, Address name);
+  // Data messages are swarmed over several peers, so a stale copy queued to a slow peer is dropped
+  // in favour of a newer message.  Control messages are never dropped in this way.
+  static SendPolicy SendPolicyFor(MessageTypeTag tag);
   Authority OurAuthority(const Address& element, const MessageHeader& header) const;
   virtual void MessageReceived(Address peer_id, SerialisedMessage serialised_message);
   // virtual void ConnectionLost(Address peer) override final;
-  void OnCloseGroupChanged(CloseGroupDifference close_group_difference);
+  void OnCloseGroupChanged(CloseGroupChange close_group_change);
   SourceAddress OurSourceAddress() const;
   SourceAddress OurSourceAddress(GroupAddress) const;
 
@@ -135,12 +181,16 @@ class RoutingNode {
   // this innocuous looking call will bootstrap the node and also be used if we spot close group
   // nodes appering or vanishing so its pretty important.
   void ConnectToCloseGroup();
+  void ConnectToBootstrapContacts();
+  void ScheduleSnapshot();
+  void WriteSnapshot();
   Address OurId() const { return Address(our_fob_.name()); }
 
  private:
+  friend struct test::RoutingNodeAccess;
+
   using unique_identifier = std::pair<Address, uint32_t>;
-  BoostAsioService crux_asio_service_;
-  AsioService asio_service_;
+  IoShards io_shards_;
   passport::Pmid our_fob_;
   std::atomic<MessageId> message_id_;
   boost::optional<Address> bootstrap_node_;
@@ -151,30 +201,52 @@ class RoutingNode {
   Sentinel sentinel_;
   LruCache<Identity, SerialisedMessage> cache_;
   std::vector<Address> connected_nodes_;
+  std::vector<crux::endpoint> bootstrap_contacts_;
+  boost::filesystem::path snapshot_path_;
+  boost::asio::steady_timer snapshot_timer_;
+  HeaderEncoding header_encoding_;
 };
 
 template <typename Child>
 RoutingNode<Child>::RoutingNode()
-    : crux_asio_service_(1),
-      asio_service_(4),
+    : RoutingNode(IoShards::DefaultCount()) {}
+
+template <typename Child>
+RoutingNode<Child>::RoutingNode(size_t io_shard_count)
+    : io_shards_(io_shard_count),
       our_fob_(passport::Pmid(passport::Anpmid())),
       message_id_(RandomUint32()),
       bootstrap_node_(boost::none),
       // bootstrap_handler_(),
-      connection_manager_(crux_asio_service_.service(), passport::PublicPmid(our_fob_)),
+      connection_manager_(io_shards_, passport::PublicPmid(our_fob_)),
       filter_(std::chrono::minutes(20)),
       sentinel_([](Address) {}, [](GroupAddress) {}),
       cache_(std::chrono::minutes(60)),
-      connected_nodes_() {
+      connected_nodes_(),
+      bootstrap_contacts_(),
+      snapshot_path_(),
+      snapshot_timer_(io_shards_.Control().service()),
+      header_encoding_(HeaderEncoding::cereal) {
   // store this to allow other nodes to get our ID on startup. IF they have full routing tables they
   // need Quorum number of these signed anyway.
   cache_.Add(our_fob_.name(), Serialise(passport::PublicPmid(our_fob_)));
   // try an connect to any local nodes (5483) Expect to be told Node_Id
   auto temp_id(MakeIdentity());
 
+  connection_manager_.SetOnCloseGroupChanged(
+      [=](CloseGroupChange close_group_change) {
+        OnCloseGroupChanged(std::move(close_group_change));
+      },
+      CloseGroupChangeWindow());
+
   connection_manager_.SetOnConnectionAdded(
       [=](Address addr) { static_cast<Child*>(this)->HandleConnectionAdded(addr); });
 
+  // The received buffer is already trimmed to the message size, so just pass ownership along.
+  connection_manager_.SetOnReceive([=](Address peer_id, SerialisedMessage serialised_message) {
+    MessageReceived(std::move(peer_id), std::move(serialised_message));
+  });
+
   // PeterJ: Start listening on ports 5483 and 5433 (why two though?)
   // rudp_.Add(rudp::Contact(temp_id, EndpointPair{rudp::Endpoint{GetLocalIp(), 5483},
   //                                                    rudp::Endpoint{GetLocalIp(), 5433}},
@@ -203,7 +275,65 @@ RoutingNode<Child>::RoutingNode()
 
 template <typename Child>
 RoutingNode<Child>::~RoutingNode() {
-  crux_asio_service_.Stop();
+  io_shards_.Stop();
+}
+
+template <typename Child>
+void RoutingNode<Child>::OnCloseGroupChanged(CloseGroupChange close_group_change) {
+  LOG(kInfo) << "Close group change: " << close_group_change.added.size() << " added, "
+             << close_group_change.removed.size() << " removed";
+  static_cast<Child*>(this)->HandleChurn(std::move(close_group_change));
+}
+
+template <typename Child>
+void RoutingNode<Child>::StartFromSnapshot(boost::filesystem::path path) {
+  io_shards_.Control().Post([=]() {
+    PeerSnapshot peers;
+    try {
+      peers = ReadPeerSnapshot(path);
+    } catch (const std::exception& e) {
+      LOG(kWarning) << "Ignoring unreadable peer snapshot " << path << ": " << e.what();
+    }
+    snapshot_path_ = path;
+    ScheduleSnapshot();
+    LOG(kInfo) << "Reconnecting to " << peers.size() << " peers from snapshot";
+    connection_manager_.Reconnect(std::move(peers), [=](size_t connected) {
+      if (connected == 0)
+        ConnectToBootstrapContacts();
+    });
+  });
+}
+
+template <typename Child>
+void RoutingNode<Child>::ConnectToBootstrapContacts() {
+  for (const auto& endpoint : bootstrap_contacts_)
+    connection_manager_.AddNode(boost::none, EndpointPair(convert::ToAsio(endpoint)));
+}
+
+template <typename Child>
+void RoutingNode<Child>::ScheduleSnapshot() {
+  snapshot_timer_.expires_from_now(SnapshotInterval());
+  snapshot_timer_.async_wait([=](const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted)
+      return;
+    WriteSnapshot();
+    ScheduleSnapshot();
+  });
+}
+
+template <typename Child>
+void RoutingNode<Child>::WriteSnapshot() {
+  if (snapshot_path_.empty())
+    return;
+  // Keep the last useful snapshot rather than replacing it with an empty one.
+  auto peers(connection_manager_.Snapshot());
+  if (peers.empty())
+    return;
+  try {
+    WritePeerSnapshot(snapshot_path_, peers);
+  } catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to write peer snapshot: " << e.what();
+  }
 }
 
 template <typename Child>
@@ -212,11 +342,12 @@ GetReturn<CompletionToken> RoutingNode<Child>::Get(Data::NameAndTypeId name_and_
                                                    CompletionToken token) {
   GetHandler<CompletionToken> handler(std::forward<decltype(token)>(token));
   asio::async_result<decltype(handler)> result(handler);
-  asio::post(asio_service_.service(), [=] {
+  io_shards_.Control().Post([=]() {
     MessageHeader our_header(std::make_pair(Destination(name_and_type_id.name), boost::none),
                              OurSourceAddress(), ++message_id_, Authority::node);
     GetData request(name_and_type_id, OurSourceAddress());
-    auto message(Serialise(our_header, MessageToTag<GetData>::value(), request));
+    auto message(
+        SerialiseBuffers(our_header, MessageToTag<GetData>::value(), request, header_encoding_));
     for (const auto& target : connection_manager_.GetTarget(name_and_type_id.name)) {
       connection_manager_.FindPeer(target)->Send(message, [](asio::error_code) {});
     }
@@ -234,16 +365,19 @@ PutReturn<CompletionToken> RoutingNode<Child>::Put(Address to, DataType data,
                                                    CompletionToken token) {
   PutHandler<CompletionToken> handler(std::forward<decltype(token)>(token));
   asio::async_result<decltype(handler)> result(handler);
-  asio::post(asio_service_.service(), [=] {
+  io_shards_.Control().Post([=]() mutable {
     MessageHeader our_header(std::make_pair(Destination(to), boost::none), OurSourceAddress(),
                              ++message_id_, Authority::client);
-    PutData request(DataType::Tag::kValue, data.serialise());
     // FIXME(dirvine) For client in real put this needs signed :08/02/2015
-    // fixme data should serialise properly and not require the above call to serialse()
-    auto message(Serialise(our_header, MessageToTag<PutData>::value(), request));
-    for (const auto& target : connection_manager_.GetTarget(to)) {
+    // fixme data should serialise properly and not require the call to serialse()
+    auto message(PutDataBuffers(our_header, MessageToTag<PutData>::value(), DataType::Tag::kValue,
+                                MakeSharedMessage(data.serialise()), header_encoding_));
+    auto targets(connection_manager_.GetTarget(to));
+    for (const auto& target : targets) {
       connection_manager_.FindPeer(target)->Send(message, [](asio::error_code) {});
     }
+    handler(targets.empty() ? asio::error_code(asio::error::host_unreachable)
+                            : asio::error_code());
   });
   return result.get();
 }
@@ -254,12 +388,13 @@ PostReturn<CompletionToken> RoutingNode<Child>::Post(Address to, FunctorType fun
                                                      CompletionToken token) {
   PostHandler<CompletionToken> handler(std::forward<decltype(token)>(token));
   asio::async_result<decltype(handler)> result(handler);
-  asio::post(asio_service_.service(), [=] {
+  io_shards_.Control().Post([=]() {
     MessageHeader our_header(std::make_pair(Destination(to), boost::none), OurSourceAddress(),
                              ++message_id_, Authority::node);
-    PutData request(FunctorType::Tag::kValue, functor);
     // FIXME(dirvine) This needs signed :08/02/2015
-    auto message(Serialise(our_header, MessageToTag<routing::Post>::value(), request));
+    auto message(PutDataBuffers(our_header, MessageToTag<routing::Post>::value(),
+                                FunctorType::Tag::kValue, MakeSharedMessage(functor),
+                                header_encoding_));
 
     for (const auto& target : connection_manager_.GetTarget(to)) {
       // FIXME(PeterJ) Call the above handler when all send handlers finish.
@@ -276,7 +411,8 @@ void RoutingNode<Child>::ConnectToCloseGroup() {
                        SourceAddress{OurSourceAddress()}, ++message_id_, Authority::node);
   if (bootstrap_node_) {
     auto peer = connection_manager_.FindPeer(*bootstrap_node_);
-    peer->Send(Serialise(header, MessageToTag<FindGroup>::value(), message),
+    peer->Send(SerialiseBuffers(header, MessageToTag<FindGroup>::value(), message,
+                                header_encoding_),
                [](asio::error_code error) {
       if (error) {
         LOG(kWarning) << "rudp cannot send via bootstrap node" << error.message();
@@ -284,10 +420,11 @@ void RoutingNode<Child>::ConnectToCloseGroup() {
     });
     return;
   }
+  auto serialised_message(
+      SerialiseBuffers(header, MessageToTag<Connect>::value(), message, header_encoding_));
   for (const auto& target : connection_manager_.GetTarget(OurId())) {
     auto peer = connection_manager_.FindPeer(target);
-    peer->Send(Serialise(header, MessageToTag<Connect>::value(), message),
-               [](asio::error_code error) {
+    peer->Send(serialised_message, [](asio::error_code error) {
       if (error) {
         LOG(kWarning) << "rudp cannot send" << error.message();
       }
@@ -295,103 +432,122 @@ void RoutingNode<Child>::ConnectToCloseGroup() {
   }
 }
 
+template <typename Child>
+SendPolicy RoutingNode<Child>::SendPolicyFor(MessageTypeTag tag) {
+  switch (tag) {
+    case MessageTypeTag::GetData:
+    case MessageTypeTag::GetDataResponse:
+    case MessageTypeTag::PutData:
+    case MessageTypeTag::PutDataResponse:
+    case MessageTypeTag::Post:
+    case MessageTypeTag::PostResponse:
+      return SendPolicy::drop_oldest;
+    default:
+      return SendPolicy::reject;
+  }
+}
+
 template <typename Child>
 void RoutingNode<Child>::MessageReceived(Address /* peer_id */,
                                          SerialisedMessage serialised_message) {
-  InputVectorStream binary_input_stream{serialised_message};
-  MessageHeader header;
-  MessageTypeTag tag;
-  Identity name;
+  // Held as a shared buffer so that forwarding to each target doesn't need its own copy.  Until we
+  // know the message is for us, only the fields needed to filter and forward it are read.
+  std::unique_ptr<MessageView> message;
   try {
-    Parse(binary_input_stream, header, tag);
+    message = maidsafe::make_unique<MessageView>(MakeSharedMessage(std::move(serialised_message)));
   } catch (const std::exception&) {
     LOG(kError) << "header failure." << boost::current_exception_diagnostic_information();
     return;
   }
 
-  if (filter_.Check(header.FilterValue()))
+  if (filter_.Check(message->FilterValue()))
     return;  // already seen
   // add to filter as soon as posible
-  filter_.Add({header.FilterValue()});
-
-  // We add these to cache
-  if (tag == MessageTypeTag::GetDataResponse) {
-    auto data = Parse<GetDataResponse>(binary_input_stream);
-    if (data.data())
-      cache_.Add(data.name_and_type_id().name, *data.data());
-  }
-  // if we can satisfy request from cache we do
-  if (tag == MessageTypeTag::GetData) {
-    auto data = Parse<GetData>(binary_input_stream);
-    auto test = cache_.Get(data.name_and_type_id().name);
-    // FIXME(dirvine) move to upper lauer :09/02/2015
-    // if (test) {
-    //   GetDataResponse response(data.name(), test);
-    //   auto message(Serialise(MessageHeader(header.Destination(), OurSourceAddress(),
-    //                                        header.MessageId(), Authority::node),
-    //                          MessageTypeTag::GetDataResponse, response));
-    //   for (const auto& target : connection_manager_.GetTarget(header.FromNode()))
-    //     rudp_.Send(target.id, message, [](asio::error_code error) {
-    //       if (error) {
-    //         LOG(kWarning) << "rudp cannot send" << error.message();
-    //       }
-    //     });
-    //   return;
-    // }
-  }
+  filter_.Add({message->FilterValue()});
 
   // send to next node(s) even our close group (swarm mode)
-  for (const auto& target : connection_manager_.GetTarget(header.Destination().first)) {
+  for (const auto& target : connection_manager_.GetTarget(message->Destination())) {
     PeerNode* peer = connection_manager_.FindPeer(target);
-    peer->Send(serialised_message, [](asio::error_code error) {
+    peer->Send(message->Serialised(), SendPolicyFor(message->Tag()), [](asio::error_code error) {
       if (error) {
         LOG(kWarning) << "cannot send" << error.message();
       }
     });
   }
-  // FIXME(dirvine) We need new rudp for this :26/01/2015
-  if (header.RelayedMessage() &&
-      std::any_of(
-          std::begin(connected_nodes_), std::end(connected_nodes_),
-          [&header](const Address& node) { return node == header.ReplyToAddress()->data; })) {
-    // send message to connected node
-    return;
-  }
 
-  if (!connection_manager_.AddressInCloseGroupRange(header.Destination().first))
-    return;  // not for us
+  try {
+    // We add these to cache
+    if (message->Tag() == MessageTypeTag::GetDataResponse) {
+      auto data = message->ParseBody<GetDataResponse>();
+      if (data.data())
+        cache_.Add(data.name_and_type_id().name, *data.data());
+    }
 
-  // FIXME(dirvine) Sentinel check here!!  :19/01/2015
-  switch (tag) {
-    case MessageTypeTag::Connect:
-      HandleMessage(Parse<Connect>(binary_input_stream), std::move(header));
-      break;
-    case MessageTypeTag::ConnectResponse:
-      HandleMessage(Parse<ConnectResponse>(binary_input_stream));
-      break;
-    case MessageTypeTag::FindGroup:
-      HandleMessage(Parse<FindGroup>(binary_input_stream), std::move(header));
-      break;
-    case MessageTypeTag::FindGroupResponse:
-      HandleMessage(Parse<FindGroupResponse>(binary_input_stream), std::move(header));
-      break;
-    case MessageTypeTag::GetData:
-      static_cast<Child*>(this)
-          ->HandleMessage(Parse<GetData>(binary_input_stream), std::move(header));
-      break;
-    case MessageTypeTag::GetDataResponse:
-      // static_cast<Child*>(this)
-      //     ->HandleMessage(Parse<GetDataResponse>(binary_input_stream), std::move(header));
-      break;
-    case MessageTypeTag::PutData:
-      HandleMessage(Parse<PutData>(binary_input_stream), std::move(header));
-      break;
-    case MessageTypeTag::Post:
-      HandleMessage(Parse<routing::Post>(binary_input_stream), std::move(header));
-      break;
-    default:
-      LOG(kWarning) << "Received message of unknown type.";
-      break;
+    // FIXME(dirvine) We need new rudp for this :26/01/2015
+    if (message->RelayedMessage() &&
+        std::any_of(std::begin(connected_nodes_), std::end(connected_nodes_),
+                    [&message](const Address& node) {
+                      return node == message->ReplyToAddress()->data;
+                    })) {
+      // send message to connected node
+      return;
+    }
+
+    if (!connection_manager_.AddressInCloseGroupRange(message->Destination()))
+      return;  // not for us
+
+    MessageHeader header(std::move(message->Header()));
+    // FIXME(dirvine) Sentinel check here!!  :19/01/2015
+    switch (message->Tag()) {
+      case MessageTypeTag::Connect:
+        HandleMessage(message->ParseBody<Connect>(), std::move(header));
+        break;
+      case MessageTypeTag::ConnectResponse:
+        HandleMessage(message->ParseBody<ConnectResponse>());
+        break;
+      case MessageTypeTag::FindGroup:
+        HandleMessage(message->ParseBody<FindGroup>(), std::move(header));
+        break;
+      case MessageTypeTag::FindGroupResponse:
+        HandleMessage(message->ParseBody<FindGroupResponse>(), std::move(header));
+        break;
+      case MessageTypeTag::GetData: {
+        auto get_data = message->ParseBody<GetData>();
+        // if we can satisfy request from cache we do
+        auto test = cache_.Get(get_data.name_and_type_id().name);
+        // FIXME(dirvine) move to upper lauer :09/02/2015
+        // if (test) {
+        //   GetDataResponse response(data.name(), test);
+        //   auto message(Serialise(MessageHeader(header.Destination(), OurSourceAddress(),
+        //                                        header.MessageId(), Authority::node),
+        //                          MessageTypeTag::GetDataResponse, response));
+        //   for (const auto& target : connection_manager_.GetTarget(header.FromNode()))
+        //     rudp_.Send(target.id, message, [](asio::error_code error) {
+        //       if (error) {
+        //         LOG(kWarning) << "rudp cannot send" << error.message();
+        //       }
+        //     });
+        //   return;
+        // }
+        static_cast<Child*>(this)->HandleMessage(std::move(get_data), std::move(header));
+        break;
+      }
+      case MessageTypeTag::GetDataResponse:
+        // static_cast<Child*>(this)
+        //     ->HandleMessage(message->ParseBody<GetDataResponse>(), std::move(header));
+        break;
+      case MessageTypeTag::PutData:
+        HandleMessage(message->ParseBody<PutData>(), std::move(header));
+        break;
+      case MessageTypeTag::Post:
+        HandleMessage(message->ParseBody<routing::Post>(), std::move(header));
+        break;
+      default:
+        LOG(kWarning) << "Received message of unknown type.";
+        break;
+    }
+  } catch (const std::exception&) {
+    LOG(kError) << "message failure." << boost::current_exception_diagnostic_information();
   }
 }
 
@@ -436,16 +592,16 @@ void RoutingNode<Child>::HandleMessage(Connect connect, MessageHeader original_h
                        SourceAddress(OurSourceAddress()), original_header.MessageId(),
                        Authority::node,
                        asymm::Sign(asymm::PlainText(Serialise(respond)), our_fob_.private_key()));
+  auto message(
+      SerialiseBuffers(header, MessageToTag<ConnectResponse>::value(), respond, header_encoding_));
   // FIXME(dirvine) Do we need to pass a shared_from_this type object or this may segfault on
   // shutdown
   // :24/01/2015
   for (auto& target : targets) {
-    connection_manager_.FindPeer(target)
-        ->Send(Serialise(header, MessageToTag<ConnectResponse>::value(), respond),
-               [connect, this](asio::error_code error_code) {
-          if (error_code)
-            return;
-        });
+    connection_manager_.FindPeer(target)->Send(message, [](asio::error_code error_code) {
+      if (error_code)
+        return;
+    });
   }
 
   connection_manager_.AddNode(NodeInfo(connect.requester_id(), connect.requester_fob(), true),
@@ -492,7 +648,8 @@ void RoutingNode<Child>::HandleMessage(FindGroup find_group, MessageHeader origi
                        SourceAddress(OurSourceAddress(GroupAddress(find_group.target_id()))),
                        original_header.MessageId(), Authority::nae_manager,
                        asymm::Sign(asymm::PlainText(Serialise(response)), our_fob_.private_key()));
-  auto message(Serialise(header, MessageToTag<FindGroupResponse>::value(), response));
+  auto message(SerialiseBuffers(header, MessageToTag<FindGroupResponse>::value(), response,
+                                header_encoding_));
   for (const auto& node : connection_manager_.GetTarget(original_header.FromNode())) {
     connection_manager_.FindPeer(node)->Send(message, [](asio::error_code) {});
   }
@@ -511,9 +668,10 @@ void RoutingNode<Child>::HandleMessage(FindGroupResponse find_group_reponse,
     Connect message(NextEndpointPair(), OurId(), node_id, passport::PublicPmid(our_fob_));
     MessageHeader header(DestinationAddress(std::make_pair(Destination(node_id), boost::none)),
                          SourceAddress{OurSourceAddress()}, ++message_id_, Authority::nae_manager);
+    auto serialised_message(
+        SerialiseBuffers(header, MessageToTag<Connect>::value(), message, header_encoding_));
     for (const auto& target : connection_manager_.GetTarget(node_id))
-      connection_manager_.FindPeer(target)->Send(
-          Serialise(header, MessageToTag<Connect>::value(), message), [](asio::error_code) {});
+      connection_manager_.FindPeer(target)->Send(serialised_message, [](asio::error_code) {});
   }
 }
 
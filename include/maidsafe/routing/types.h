@@ -21,6 +21,8 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -45,8 +47,27 @@ namespace maidsafe {
 
 namespace routing {
 
-static const size_t GroupSize = 23;
-static const size_t QuorumSize = 19;
+// The sizes which shape the network.  Classes sensitive to these take a 'NetworkParameters' policy
+// as a template parameter; any type with the same static members can be used in place of this
+// stock configuration, allowing e.g. a small network in tests or a larger routing table.
+//   GroupSize   - the number of nodes in a close group
+//   QuorumSize  - the number of matching messages needed from a group to accept a group message
+//   BucketSize  - the number of contacts a routing table keeps per bucket outside its close group
+//   Parallelism - the number of contacts a message not destined for our close group is sent to
+//   OptimalSize - the size a routing table fills up to before it starts evicting contacts
+//   ReplacementCacheSize - the number of contacts offered to but not added by a routing table
+//       which it remembers per bucket, to replace any contact dropped from that bucket
+struct DefaultNetworkParameters {
+  static const size_t GroupSize = 23;
+  static const size_t QuorumSize = 19;
+  static const size_t BucketSize = 1;
+  static const size_t Parallelism = 4;
+  static const size_t OptimalSize = 64;
+  static const size_t ReplacementCacheSize = 4;
+};
+
+static const size_t GroupSize = DefaultNetworkParameters::GroupSize;
+static const size_t QuorumSize = DefaultNetworkParameters::QuorumSize;
 
 enum class FromType : int32_t {
   client_manager,
@@ -75,6 +96,15 @@ using DestinationAddress = std::pair<Destination, boost::optional<ReplyToAddress
 using NodeAddress = TaggedValue<Address, struct NodeTag>;
 using GroupAddress = TaggedValue<Address, struct GroupTag>;
 
+// Addresses are uniformly distributed, so their leading bytes are already a good hash value.
+struct AddressHash {
+  size_t operator()(const Address& address) const {
+    size_t result(0);
+    std::memcpy(&result, address.string().data(), sizeof(result));
+    return result;
+  }
+};
+
 using SendGetClientKey = std::function<void(Address)>;
 using SendGetGroupKey = std::function<void(GroupAddress)>;
 
@@ -95,9 +125,32 @@ using HandlePostReturn =
 using Endpoint = asio::ip::udp::endpoint;
 using Port = uint16_t;
 using SerialisedMessage = std::vector<byte>;
+// An immutable message which can be sent to several peers without being copied for each one.
+using SharedMessage = std::shared_ptr<const SerialisedMessage>;
 using CloseGroupDifference = std::pair<std::vector<Address>, std::vector<Address>>;
+// The IDs which have joined and left our close group.
+struct CloseGroupChange {
+  bool empty() const { return added.empty() && removed.empty(); }
+  std::vector<Address> added;
+  std::vector<Address> removed;
+};
 using PublicKeyId = std::pair<Address, asymm::PublicKey>;
 
+inline SharedMessage MakeSharedMessage(SerialisedMessage message) {
+  return std::make_shared<SerialisedMessage>(std::move(message));
+}
+
+// A message held as a sequence of buffers and sent as their concatenation, so that a large body
+// can be shared rather than copied in behind the serialised header.
+using SharedBuffers = std::vector<SharedMessage>;
+
+inline std::size_t BufferSize(const SharedBuffers& buffers) {
+  std::size_t size(0);
+  for (const auto& buffer : buffers)
+    size += buffer->size();
+  return size;
+}
+
 template <typename CompletionToken>
 using BootstrapHandlerHandler =
     typename asio::handler_type<CompletionToken, void(asio::error_code, Contact)>::type;
@@ -40,11 +40,14 @@ namespace maidsafe {
 namespace routing {
 
 // Accumulate data parts with time_to_live LRU-replacement cache
-// requires sender id to ensure parts are delivered from different senders
-template <typename NameType, typename ValueType>
+// requires sender id to ensure parts are delivered from different senders.  Unless given, the
+// quorum is the 'QuorumSize' of the 'NetworkParameters' policy.
+template <typename NameType, typename ValueType,
+          typename NetworkParameters = DefaultNetworkParameters>
 class Accumulator {
  public:
-  Accumulator(std::chrono::steady_clock::duration time_to_live, uint32_t quorum)
+  explicit Accumulator(std::chrono::steady_clock::duration time_to_live,
+                       uint32_t quorum = NetworkParameters::QuorumSize)
       : time_to_live_(time_to_live), quorum_(quorum) {}
 
   ~Accumulator() = default;
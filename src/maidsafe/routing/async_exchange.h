@@ -23,6 +23,7 @@
 
 #include "maidsafe/crux/socket.hpp"
 
+#include "maidsafe/routing/buffer_pool.h"
 #include "maidsafe/routing/types.h"
 
 namespace maidsafe {
@@ -36,13 +37,14 @@ void AsyncExchange(crux::socket& socket, SerialisedMessage our_data, Handler han
 
   struct State {
     boost::optional<boost::system::error_code> first_error;
-    SerialisedMessage rx_buffer;
+    BufferPool::Buffer rx_buffer;
+    SerialisedMessage received;
     SerialisedMessage tx_buffer;
   };
 
   auto state = std::make_shared<State>();
 
-  state->rx_buffer.resize(max_buffer_size);
+  state->rx_buffer = SharedBufferPool().Borrow(max_buffer_size);
   state->tx_buffer = std::move(our_data);
 
   socket.async_send(boost::asio::buffer(state->tx_buffer),
@@ -54,14 +56,19 @@ void AsyncExchange(crux::socket& socket, SerialisedMessage our_data, Handler han
       if (error) {
         return handler(error, SerialisedMessage());
       }
-      return handler(error, std::move(state->rx_buffer));
+      return handler(error, std::move(state->received));
     } else {
       state->first_error = error;
     }
   });
 
-  socket.async_receive(boost::asio::buffer(state->rx_buffer),
+  socket.async_receive(boost::asio::buffer(state->rx_buffer.data(), max_buffer_size),
                        [state, handler](boost::system::error_code error, std::size_t size) {
+    if (!error)
+      state->received.assign(state->rx_buffer.data(), state->rx_buffer.data() + size);
+    // The handshake is done with the pooled buffer either way, so give it back straight away.
+    state->rx_buffer.Release();
+
     if (state->first_error) {
       if (*state->first_error) {
         return handler(*state->first_error, SerialisedMessage());
@@ -69,8 +76,7 @@ void AsyncExchange(crux::socket& socket, SerialisedMessage our_data, Handler han
       if (error) {
         return handler(error, SerialisedMessage());
       }
-      state->rx_buffer.resize(size);
-      return handler(error, std::move(state->rx_buffer));
+      return handler(error, std::move(state->received));
     } else {
       state->first_error = error;
     }
@@ -0,0 +1,118 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/batch_frame.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+
+#include "maidsafe/common/error.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const std::array<byte, 8> kMagic = {{'M', 'S', 'B', 'A', 'T', 'C', 'H', 1}};
+const std::size_t kHeaderSize = 10;
+const std::size_t kSizePrefix = 4;
+
+template <typename Integer>
+void Store(Integer value, byte* out) {
+  for (std::size_t i(0); i < sizeof(Integer); ++i)
+    out[i] = static_cast<byte>(static_cast<uint64_t>(value) >> (8 * i));
+}
+
+template <typename Integer>
+Integer Load(const byte* in) {
+  uint64_t value(0);
+  for (std::size_t i(0); i < sizeof(Integer); ++i)
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  return static_cast<Integer>(value);
+}
+
+}  // unnamed namespace
+
+std::size_t BatchFrameOverhead(std::size_t message_count) {
+  return kHeaderSize + message_count * kSizePrefix;
+}
+
+std::size_t MaxBatchFrameMessages() { return std::numeric_limits<uint16_t>::max(); }
+
+bool IsBatchFrame(const SerialisedMessage& bytes) {
+  return bytes.size() >= kHeaderSize && std::equal(kMagic.begin(), kMagic.end(), bytes.begin());
+}
+
+SerialisedMessage MakeBatchFrame(const std::vector<SharedMessage>& messages) {
+  std::vector<SharedBuffers> buffers;
+  buffers.reserve(messages.size());
+  for (const auto& message : messages)
+    buffers.emplace_back(1, message);
+  return MakeBatchFrame(buffers);
+}
+
+SerialisedMessage MakeBatchFrame(const std::vector<SharedBuffers>& messages) {
+  assert(messages.size() <= MaxBatchFrameMessages());
+  std::size_t size(BatchFrameOverhead(messages.size()));
+  for (const auto& message : messages)
+    size += BufferSize(message);
+
+  SerialisedMessage frame(size);
+  auto out(frame.data());
+  out = std::copy(kMagic.begin(), kMagic.end(), out);
+  Store(static_cast<uint16_t>(messages.size()), out);
+  out += 2;
+  for (const auto& message : messages) {
+    Store(static_cast<uint32_t>(BufferSize(message)), out);
+    out += kSizePrefix;
+    for (const auto& buffer : message)
+      out = std::copy(buffer->begin(), buffer->end(), out);
+  }
+  return frame;
+}
+
+std::vector<SerialisedMessage> ParseBatchFrame(const SerialisedMessage& frame) {
+  if (!IsBatchFrame(frame))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+
+  const auto count(Load<uint16_t>(frame.data() + kMagic.size()));
+  std::vector<SerialisedMessage> messages;
+  messages.reserve(count);
+  auto in(frame.data() + kHeaderSize);
+  const auto end(frame.data() + frame.size());
+  for (uint16_t i(0); i < count; ++i) {
+    if (static_cast<std::size_t>(end - in) < kSizePrefix)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    const auto size(Load<uint32_t>(in));
+    in += kSizePrefix;
+    if (static_cast<std::size_t>(end - in) < size)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    messages.emplace_back(in, in + size);
+    in += size;
+  }
+  if (in != end)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return messages;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,57 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_BATCH_FRAME_H_
+#define MAIDSAFE_ROUTING_BATCH_FRAME_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A batch frame carries several messages for the same peer in a single send.  It is an 8-byte
+// magic, a 2-byte message count, then each message as a 4-byte size followed by its bytes.  All
+// integers are little-endian.  A serialised message starts with a 64-bit size prefix; read as
+// such, the magic is far larger than any message could be, so a frame can't be mistaken for one.
+
+// The bytes a frame of 'message_count' messages adds to the messages themselves.
+std::size_t BatchFrameOverhead(std::size_t message_count);
+
+// The most messages a frame can hold.
+std::size_t MaxBatchFrameMessages();
+
+bool IsBatchFrame(const SerialisedMessage& bytes);
+
+// 'messages' must hold no more than 'MaxBatchFrameMessages()' messages.
+SerialisedMessage MakeBatchFrame(const std::vector<SharedMessage>& messages);
+SerialisedMessage MakeBatchFrame(const std::vector<SharedBuffers>& messages);
+
+// Throws 'CommonErrors::parsing_error' if 'frame' isn't a valid batch frame.
+std::vector<SerialisedMessage> ParseBatchFrame(const SerialisedMessage& frame);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_BATCH_FRAME_H_
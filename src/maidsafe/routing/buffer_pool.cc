@@ -0,0 +1,117 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/buffer_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const std::array<std::size_t, BufferPool::kSizeClassCount> kSizeClasses = {
+    {4096, 65536, 262144, 1048576}};
+
+std::size_t SizeClassIndex(std::size_t size_class) {
+  return static_cast<std::size_t>(
+      std::distance(std::begin(kSizeClasses),
+                    std::find(std::begin(kSizeClasses), std::end(kSizeClasses), size_class)));
+}
+
+}  // unnamed namespace
+
+const std::size_t BufferPool::kPageSize;
+const std::size_t BufferPool::kSizeClassCount;
+
+void BufferPool::Buffer::Release() {
+  if (pool_)
+    pool_->Return(std::move(slab_), size_);
+  pool_ = nullptr;
+  slab_ = Slab();
+  size_ = 0;
+}
+
+BufferPool::BufferPool(std::size_t max_free_per_class)
+    : max_free_per_class_(max_free_per_class),
+      mutex_(),
+      free_slabs_(),
+      hits_(0),
+      misses_(0),
+      bytes_in_use_(0) {}
+
+BufferPool::Buffer BufferPool::Borrow(std::size_t size) {
+  auto size_class(SizeClass(size));
+  if (size_class != 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& free_slabs(free_slabs_[SizeClassIndex(size_class)]);
+    if (!free_slabs.empty()) {
+      Slab slab(std::move(free_slabs.back()));
+      free_slabs.pop_back();
+      ++hits_;
+      bytes_in_use_ += size_class;
+      return Buffer(this, std::move(slab), size_class);
+    }
+  } else {
+    size_class = size;
+  }
+
+  // Over-allocate by a page so the usable region can start on a page boundary.
+  Slab slab;
+  slab.storage.reset(new byte[size_class + kPageSize]);
+  auto address(reinterpret_cast<std::uintptr_t>(slab.storage.get()));
+  slab.data = slab.storage.get() + ((kPageSize - (address % kPageSize)) % kPageSize);
+  ++misses_;
+  bytes_in_use_ += size_class;
+  return Buffer(this, std::move(slab), size_class);
+}
+
+BufferPool::Stats BufferPool::GetStats() const {
+  Stats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.bytes_in_use = bytes_in_use_;
+  return stats;
+}
+
+std::size_t BufferPool::SizeClass(std::size_t size) {
+  auto itr(std::lower_bound(std::begin(kSizeClasses), std::end(kSizeClasses), size));
+  return itr == std::end(kSizeClasses) ? 0 : *itr;
+}
+
+void BufferPool::Return(Slab slab, std::size_t size) {
+  assert(bytes_in_use_ >= size);
+  bytes_in_use_ -= size;
+  if (SizeClass(size) != size)
+    return;  // not pooled, so just let it be freed
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& free_slabs(free_slabs_[SizeClassIndex(size)]);
+  if (free_slabs.size() < max_free_per_class_)
+    free_slabs.push_back(std::move(slab));
+}
+
+BufferPool& SharedBufferPool() {
+  static BufferPool pool;
+  return pool;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
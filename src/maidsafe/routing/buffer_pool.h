@@ -0,0 +1,131 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_BUFFER_POOL_H_
+#define MAIDSAFE_ROUTING_BUFFER_POOL_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "maidsafe/common/config.h"
+#include "maidsafe/common/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A pool of reusable byte buffers, handed out in a few fixed size classes.  Requests are rounded
+// up to the smallest class which can hold them; requests larger than the biggest class are
+// allocated and freed directly (and counted as misses).  Slabs are page-aligned.  Up to
+// 'max_free_per_class' returned slabs are kept per class, anything beyond that is freed.
+//
+// The pool is threadsafe.  A borrowed Buffer returns its slab to the pool when it is destroyed,
+// so the pool must outlive all of its Buffers.
+class BufferPool {
+  struct Slab {
+    std::unique_ptr<byte[]> storage;
+    byte* data;
+  };
+
+ public:
+  static const std::size_t kPageSize = 4096;
+  static const std::size_t kSizeClassCount = 4;
+
+  struct Stats {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t bytes_in_use;
+  };
+
+  class Buffer {
+   public:
+    Buffer() MAIDSAFE_NOEXCEPT : pool_(nullptr), slab_(), size_(0) {}
+    Buffer(Buffer&& other) MAIDSAFE_NOEXCEPT : pool_(other.pool_),
+                                               slab_(std::move(other.slab_)),
+                                               size_(other.size_) {
+      other.pool_ = nullptr;
+      other.size_ = 0;
+    }
+    Buffer& operator=(Buffer&& other) MAIDSAFE_NOEXCEPT {
+      if (this != &other) {
+        Release();
+        pool_ = other.pool_;
+        slab_ = std::move(other.slab_);
+        size_ = other.size_;
+        other.pool_ = nullptr;
+        other.size_ = 0;
+      }
+      return *this;
+    }
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+    ~Buffer() { Release(); }
+
+    byte* data() const { return slab_.data; }
+    // This is the size of the slab's size class, i.e. at least the size which was requested.
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Returns the slab to the pool early.  The Buffer is left empty.
+    void Release();
+
+   private:
+    friend class BufferPool;
+    Buffer(BufferPool* pool, Slab slab, std::size_t size)
+        : pool_(pool), slab_(std::move(slab)), size_(size) {}
+
+    BufferPool* pool_;
+    Slab slab_;
+    std::size_t size_;
+  };
+
+  explicit BufferPool(std::size_t max_free_per_class = 32);
+  BufferPool(const BufferPool&) = delete;
+  BufferPool(BufferPool&&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+  BufferPool& operator=(BufferPool&&) = delete;
+  ~BufferPool() = default;
+
+  Buffer Borrow(std::size_t size);
+
+  Stats GetStats() const;
+
+  // Returns the size class which 'size' will be rounded up to, or 0 if it's too big to be pooled.
+  static std::size_t SizeClass(std::size_t size);
+
+ private:
+  void Return(Slab slab, std::size_t size);
+
+  const std::size_t max_free_per_class_;
+  mutable std::mutex mutex_;
+  std::array<std::vector<Slab>, kSizeClassCount> free_slabs_;
+  std::atomic<std::uint64_t> hits_, misses_, bytes_in_use_;
+};
+
+// The pool shared by all peers' receive buffers, Connections and AsyncExchange.
+BufferPool& SharedBufferPool();
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_BUFFER_POOL_H_
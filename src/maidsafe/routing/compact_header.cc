@@ -0,0 +1,221 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/compact_header.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const std::uint8_t kVersion = 0x81;
+const std::size_t kPresenceOffset = 1;
+const std::size_t kAuthorityOffset = 2;
+const std::size_t kDestinationOffset = 3;
+const std::size_t kFromNodeOffset = kDestinationOffset + identity_size;
+const std::size_t kOptionalAddressesOffset = kFromNodeOffset + identity_size;
+
+enum Presence : std::uint8_t {
+  kDestination = 1 << 0,
+  kFromNode = 1 << 1,
+  kDestinationReplyTo = 1 << 2,
+  kFromGroup = 1 << 3,
+  kFromReplyTo = 1 << 4,
+  kSignature = 1 << 5
+};
+const std::uint8_t kAllPresence = (1 << 6) - 1;
+
+void AppendAddress(const Address& address, SerialisedMessage& out) {
+  if (address.IsInitialised())
+    out.insert(out.end(), address.string().begin(), address.string().end());
+  else
+    out.resize(out.size() + identity_size, 0);
+}
+
+void AppendVarint(std::uint64_t value, SerialisedMessage& out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<byte>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<byte>(value));
+}
+
+Address LoadAddress(const SerialisedMessage& message, std::size_t offset) {
+  if (message.size() - offset < identity_size)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return Address(std::string(message.begin() + offset, message.begin() + offset + identity_size));
+}
+
+std::uint64_t LoadVarint(const SerialisedMessage& message, std::size_t& offset) {
+  std::uint64_t value(0);
+  for (unsigned shift(0); shift < 64 && offset < message.size(); shift += 7) {
+    const auto next(message[offset++]);
+    value |= static_cast<std::uint64_t>(next & 0x7f) << shift;
+    if ((next & 0x80) == 0)
+      return value;
+  }
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+// The fields read in place, plus where to find the others.
+struct Located {
+  CompactHeaderFields fields;
+  std::uint8_t presence;
+  std::size_t destination_reply_to_offset, from_group_offset, signature_offset, signature_size;
+};
+
+Located Locate(const SerialisedMessage& message) {
+  if (message.size() < kOptionalAddressesOffset || message[0] != kVersion)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  Located located;
+  located.presence = message[kPresenceOffset];
+  if ((located.presence & ~kAllPresence) != 0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  auto present = [&](Presence field) { return (located.presence & field) != 0; };
+
+  auto& fields(located.fields);
+  if (present(kDestination))
+    fields.destination = Destination(LoadAddress(message, kDestinationOffset));
+  if (present(kFromNode))
+    fields.from_node = NodeAddress(LoadAddress(message, kFromNodeOffset));
+
+  std::size_t offset(kOptionalAddressesOffset);
+  auto next_slot = [&](Presence field) -> std::size_t {
+    if (!present(field))
+      return 0;
+    if (message.size() - offset < identity_size)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    offset += identity_size;
+    return offset - identity_size;
+  };
+  located.destination_reply_to_offset = next_slot(kDestinationReplyTo);
+  located.from_group_offset = next_slot(kFromGroup);
+  if (auto reply_to_offset = next_slot(kFromReplyTo))
+    fields.reply_to_address = ReplyToAddress(LoadAddress(message, reply_to_offset));
+
+  const auto message_id(LoadVarint(message, offset));
+  if (message_id > std::numeric_limits<MessageId>::max())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  fields.message_id = static_cast<MessageId>(message_id);
+
+  located.signature_offset = located.signature_size = 0;
+  if (present(kSignature)) {
+    const auto signature_size(LoadVarint(message, offset));
+    if (signature_size > message.size() - offset)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    located.signature_offset = offset;
+    located.signature_size = static_cast<std::size_t>(signature_size);
+    offset += located.signature_size;
+  }
+  fields.size = offset;
+  return located;
+}
+
+}  // unnamed namespace
+
+std::uint8_t CompactHeaderVersion() { return kVersion; }
+
+bool IsCompactHeader(const SerialisedMessage& message) {
+  return !message.empty() && (message[0] & 0x80) != 0;
+}
+
+SerialisedMessage SerialiseCompactHeader(const MessageHeader& header) {
+  const auto destination(header.Destination());
+  const auto source(header.Source());
+  const auto signature(header.Signature());
+  std::uint8_t presence(0);
+  if (destination.first->IsInitialised())
+    presence |= kDestination;
+  if (source.node_address->IsInitialised())
+    presence |= kFromNode;
+  if (destination.second)
+    presence |= kDestinationReplyTo;
+  if (source.group_address)
+    presence |= kFromGroup;
+  if (source.reply_to_address)
+    presence |= kFromReplyTo;
+  if (signature)
+    presence |= kSignature;
+
+  SerialisedMessage out;
+  out.reserve(kOptionalAddressesOffset + 3 * identity_size + 16);
+  out.push_back(kVersion);
+  out.push_back(presence);
+  out.push_back(static_cast<byte>(header.FromAuthority()));
+  AppendAddress(destination.first.data, out);
+  AppendAddress(source.node_address.data, out);
+  if (destination.second)
+    AppendAddress(destination.second->data, out);
+  if (source.group_address)
+    AppendAddress(source.group_address->data, out);
+  if (source.reply_to_address)
+    AppendAddress(source.reply_to_address->data, out);
+  AppendVarint(header.MessageId(), out);
+  if (signature) {
+    const auto serialised_signature(Serialise(*signature));
+    AppendVarint(serialised_signature.size(), out);
+    out.insert(out.end(), serialised_signature.begin(), serialised_signature.end());
+  }
+  return out;
+}
+
+MessageHeader ParseCompactHeader(const SerialisedMessage& message, std::size_t& size) {
+  const auto located(Locate(message));
+  const auto& fields(located.fields);
+
+  const auto authority(message[kAuthorityOffset]);
+  if (authority > static_cast<std::uint8_t>(Authority::client))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+
+  DestinationAddress destination(fields.destination, boost::none);
+  if (located.destination_reply_to_offset != 0) {
+    destination.second =
+        ReplyToAddress(LoadAddress(message, located.destination_reply_to_offset));
+  }
+  SourceAddress source(fields.from_node, boost::none, fields.reply_to_address);
+  if (located.from_group_offset != 0)
+    source.group_address = GroupAddress(LoadAddress(message, located.from_group_offset));
+
+  size = fields.size;
+  if ((located.presence & kSignature) == 0) {
+    return MessageHeader(std::move(destination), std::move(source), fields.message_id,
+                         static_cast<Authority>(authority));
+  }
+  const auto signature_begin(message.begin() + located.signature_offset);
+  return MessageHeader(std::move(destination), std::move(source), fields.message_id,
+                       static_cast<Authority>(authority),
+                       Parse<asymm::Signature>(SerialisedMessage(
+                           signature_begin, signature_begin + located.signature_size)));
+}
+
+CompactHeaderFields ReadCompactHeaderFields(const SerialisedMessage& message) {
+  return Locate(message).fields;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,78 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_COMPACT_HEADER_H_
+#define MAIDSAFE_ROUTING_COMPACT_HEADER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A compact encoding of 'MessageHeader', an alternative to serialising it through cereal:
+//
+//   offset  size  field
+//        0     1  version: the high bit is set, marking this as a compact header
+//        1     1  presence bitmask: which of the addresses and the signature are present
+//        2     1  authority
+//        3    64  destination
+//       67    64  source node
+//      131  64*n  any of the destination's reply-to, source group and source reply-to addresses
+//                 which are present, in that order
+//               -  message ID as a varint
+//               -  if present, the signature's serialised size as a varint, then the signature
+//
+// An absent destination or source node leaves its slot zero-filled, so those are always at the
+// same offsets.  A cereal-encoded header starts with the low byte of an address's 64-bit size,
+// which is 0 or 64, so can't be mistaken for a compact one.
+
+std::uint8_t CompactHeaderVersion();
+
+bool IsCompactHeader(const SerialisedMessage& message);
+
+SerialisedMessage SerialiseCompactHeader(const MessageHeader& header);
+
+// Parses the compact header at the start of 'message', setting 'size' to the bytes it occupies.
+// Throws 'CommonErrors::parsing_error' if it isn't a valid compact header of this version.
+MessageHeader ParseCompactHeader(const SerialisedMessage& message, std::size_t& size);
+
+// The fields needed to filter and forward a message, read in place from the compact header at the
+// start of 'message' without parsing the rest of it.
+struct CompactHeaderFields {
+  Destination destination;
+  NodeAddress from_node;
+  boost::optional<ReplyToAddress> reply_to_address;
+  MessageId message_id;
+  std::size_t size;
+};
+
+// Throws 'CommonErrors::parsing_error' as 'ParseCompactHeader' does.
+CompactHeaderFields ReadCompactHeaderFields(const SerialisedMessage& message);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_COMPACT_HEADER_H_
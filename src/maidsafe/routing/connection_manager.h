@@ -38,65 +38,138 @@ destiations. In that case request a close_group message for this node.
 #ifndef MAIDSAFE_ROUTING_CONNECTION_MANAGER_H_
 #define MAIDSAFE_ROUTING_CONNECTION_MANAGER_H_
 
+#include <chrono>
+#include <algorithm>
+#include <array>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <map>
-#include <set>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "asio/io_service.hpp"
+#include "boost/asio/steady_timer.hpp"
+#include "boost/iterator/indirect_iterator.hpp"
 #include "boost/optional.hpp"
 
+#include "maidsafe/common/convert.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/utils.h"
 #include "maidsafe/crux/socket.hpp"
 #include "maidsafe/crux/acceptor.hpp"
 
+#include "maidsafe/routing/async_exchange.h"
+#include "maidsafe/routing/batch_frame.h"
+#include "maidsafe/routing/io_shards.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/types.h"
 #include "maidsafe/routing/peer_node.h"
+#include "maidsafe/routing/peer_snapshot.h"
+#include "maidsafe/routing/xor_distance.h"
 
 namespace maidsafe {
 
 namespace routing {
 
-class ConnectionManager {
+namespace test {
+struct ConnectionManagerAccess;
+}  // namespace test
+
+// The peers kept are those our routing table holds: a peer which connects (or which we connect
+// to) is only kept if the table adds it, and a peer the table drops to make room is disconnected.
+// So the peer set stays within the table's bounds however many peers try to connect.
+//
+// If constructed with 'IoShards', the manager runs on the control shard, and the socket of a node
+// we connect to by ID is placed on the shard that ID hashes to.  Peers which connect to us, and
+// nodes connected to by endpoint alone, stay on the control shard.
+//
+// The sizes governing the peer set are taken from the 'NetworkParameters' policy (see
+// 'DefaultNetworkParameters'); 'ConnectionManager' is the manager for the stock network.
+template <typename NetworkParameters>
+class BasicConnectionManager {
+  static_assert(0 < NetworkParameters::Parallelism &&
+                    NetworkParameters::Parallelism <= NetworkParameters::GroupSize &&
+                    NetworkParameters::GroupSize < NetworkParameters::OptimalSize,
+                "NetworkParameters must have 0 < Parallelism <= GroupSize < OptimalSize.");
+  static_assert(NetworkParameters::BucketSize >= 1, "NetworkParameters must have BucketSize >= 1.");
+
   using PublicPmid = passport::PublicPmid;
+  using Table = BasicRoutingTable<NetworkParameters>;
+
+ public:
+  // The peers chosen by 'GetTarget', in order of closeness to the target.  At most 'GroupSize'
+  // are held, in place, as references to the managed peers' addresses; so a 'Targets' is only
+  // valid until the set of peers next changes.
+  class Targets {
+    using Addresses = std::array<const Address*, NetworkParameters::GroupSize>;
 
-  class Comparison {
    public:
-    explicit Comparison(Address our_id) : our_id_(std::move(our_id)) {}
+    using const_iterator = boost::indirect_iterator<typename Addresses::const_iterator>;
 
-    bool operator()(const Address& lhs, const Address& rhs) const {
-      return CloserToTarget(lhs, rhs, our_id_);
-    }
+    Targets() : addresses_(), size_(0) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Address& operator[](size_t i) const { return *addresses_[i]; }
+    const_iterator begin() const { return const_iterator(addresses_.begin()); }
+    const_iterator end() const { return const_iterator(addresses_.begin() + size_); }
 
    private:
-    const Address our_id_;
+    friend class BasicConnectionManager;
+    Addresses addresses_;
+    size_t size_;
   };
 
- public:
-  ConnectionManager(boost::asio::io_service& ios, PublicPmid our_fob);
+  BasicConnectionManager(boost::asio::io_service& ios, PublicPmid our_fob);
+  BasicConnectionManager(IoShards& shards, PublicPmid our_fob);
 
-  ConnectionManager(const ConnectionManager&) = delete;
-  ConnectionManager(ConnectionManager&&) = delete;
-  ~ConnectionManager() = default;
-  ConnectionManager& operator=(const ConnectionManager&) = delete;
-  ConnectionManager& operator=(ConnectionManager&&) = delete;
+  BasicConnectionManager(const BasicConnectionManager&) = delete;
+  BasicConnectionManager(BasicConnectionManager&&) = delete;
+  ~BasicConnectionManager() = default;
+  BasicConnectionManager& operator=(const BasicConnectionManager&) = delete;
+  BasicConnectionManager& operator=(BasicConnectionManager&&) = delete;
 
   bool IsManaged(const Address& node_to_add) const;
-  std::set<Address, Comparison> GetTarget(const Address& target_node) const;
-  // boost::optional<CloseGroupDifference> LostNetworkConnection(const Address& node);
+  // The connected peers to which a message for 'target' should be sent onwards: those in our
+  // close group if 'target' is in range of it (see 'AddressInCloseGroupRange'), otherwise the
+  // 'Parallelism' peers closest to 'target'.
+  Targets GetTarget(const Address& target) const;
+  // boost::optional<CloseGroupChange> LostNetworkConnection(const Address& node);
   // routing wishes to drop a specific node (may be a node we cannot connect to)
-  boost::optional<CloseGroupDifference> DropNode(const Address& their_id);
+  boost::optional<CloseGroupChange> DropNode(const Address& their_id);
+  // As above for each of 'their_ids', reporting the close group change once for the whole batch
+  boost::optional<CloseGroupChange> DropNodes(const std::vector<Address>& their_ids);
+  // Connects to the node at the given endpoints.  If 'node_to_add' is given, the node isn't
+  // connected to unless our routing table would hold it, and is only kept if it proves to be that
+  // node.
   void AddNode(boost::optional<NodeInfo> node_to_add, EndpointPair);
+  // As above, invoking 'handler' once the attempt to connect has succeeded or failed.
+  template <typename Handler /* void(asio::error_code) */>
+  void AddNode(boost::optional<NodeInfo> node_to_add, EndpointPair, Handler handler);
+
+  // The peers we're connected to, for writing to a snapshot.  Peers which connected to us are
+  // left out, as we don't know where they accept connections.
+  PeerSnapshot Snapshot() const;
+  // Connects to all of 'peers' at once, then invokes 'handler' with the number which succeeded.
+  template <typename Handler /* void(size_t) */>
+  void Reconnect(PeerSnapshot peers, Handler handler);
+
+  // How long after this manager was constructed it first held a full close group, or 'none' if it
+  // hasn't yet.
+  boost::optional<std::chrono::steady_clock::duration> TimeToFullCloseGroup() const {
+    return time_to_full_close_group_;
+  }
 
   std::vector<PublicPmid> OurCloseGroup() const {
     std::vector<PublicPmid> result;
-    result.reserve(GroupSize);
-    size_t i = 0;
-    for (const auto& pair : peers_) {
-      if (++i > GroupSize)
-        break;
-      result.push_back(pair.second.node_info().dht_fob);
-    }
+    result.reserve(NetworkParameters::GroupSize);
+    for (size_t i(0); i < std::min(peers_.size(), CloseGroupSize()); ++i)
+      result.push_back(peers_[i]->node_info().dht_fob);
     return result;
   }
 
@@ -104,30 +177,34 @@ class ConnectionManager {
   //   return routing_table_.BucketIndex(routing_table_.OurCloseGroup().back().id);
   // }
 
+  // True if 'address' is closer to us than the furthest member of our close group, or if we have
+  // fewer than 'GroupSize' peers.
   bool AddressInCloseGroupRange(const Address& address) const {
-    if (peers_.size() < GroupSize)
-      return true;
-    return (static_cast<std::size_t>(std::distance(peers_.begin(), peers_.upper_bound(address))) <
-            GroupSize);
+    return peers_.size() < CloseGroupSize() ||
+           XorDistanceBetween(our_id_, address) < close_group_radius_;
   }
 
+  // The distance from us to the furthest member of our close group, or the maximum distance if we
+  // have fewer than 'GroupSize' peers.
+  const XorDistance& CloseGroupRadius() const { return close_group_radius_; }
+
   const Address& OurId() const { return our_id_; }
 
   boost::optional<asymm::PublicKey> GetPublicKey(const Address& node) const {
-    auto found_i = peers_.find(node);
-    if (found_i == peers_.end()) { return boost::none; }
-    return found_i->second.node_info().dht_fob.public_key();
+    auto found_i = index_.find(node);
+    if (found_i == index_.end()) { return boost::none; }
+    return found_i->second->node_info().dht_fob.public_key();
   }
 
   // bool CloseGroupMember(const Address& their_id);
 
   uint32_t Size() { return static_cast<uint32_t>(peers_.size()); }
 
-  PeerNode* FindPeer(Address addr) {
-    auto i = peers_.find(addr);
-    if (i == peers_.end())
+  PeerNode* FindPeer(const Address& addr) {
+    auto i = index_.find(addr);
+    if (i == index_.end())
       return nullptr;
-    return &i->second;
+    return i->second;
   }
 
   void StartAccepting(unsigned short port);
@@ -142,36 +219,702 @@ class ConnectionManager {
     on_receive_ = std::move(handler);
   }
 
+  // 'handler' is invoked with the net change to our close group at most once per 'window': the
+  // first change starts the window, and any further changes within it are merged into the one
+  // notification.  A node which joins and then leaves within the window (or vice versa) isn't
+  // reported.
+  template <class Handler /* void(CloseGroupChange) */>
+  void SetOnCloseGroupChanged(Handler handler, std::chrono::steady_clock::duration window) {
+    on_close_group_changed_ = std::move(handler);
+    close_group_change_window_ = window;
+  }
+
+  // Coalesces small messages sent to each peer, current and future, into batch frames (see
+  // 'PeerNode::EnableBatching').  Batch frames are always unpacked on receipt, so this only needs
+  // enabling on the sending side.
+  void EnableBatching(BatchingOptions options) {
+    batching_ = options;
+    for (auto& peer : peers_)
+      peer->EnableBatching(options);
+  }
+
+  // Handlers of connection attempts still in progress are not invoked after this.
   void Shutdown() {
+    destroy_indicator_ = std::make_shared<boost::none_t>();
     acceptors_.clear();
     being_connected_.clear();
+    index_.clear();
+    distances_.clear();
     peers_.clear();
+    routing_table_ = maidsafe::make_unique<Table>(our_id_);
+    UpdateCloseGroupRadius();
+    current_close_group_.clear();
+    close_group_changed_ = false;
+    pending_close_group_change_ = CloseGroupChange();
+    close_group_change_timer_.cancel();
+    close_group_change_pending_ = false;
   }
 
  private:
-  boost::optional<CloseGroupDifference> GroupChanged();
-  void InsertPeer(PeerNode&&);
+  friend struct test::ConnectionManagerAccess;
+
+  static size_t CloseGroupSize() { return NetworkParameters::GroupSize; }
+
+  // Brings 'current_close_group_' up to date if a peer has joined or left the close group since it
+  // was last called, returning (and queuing for 'on_close_group_changed_') the difference.
+  boost::optional<CloseGroupChange> GroupChanged();
+  void QueueCloseGroupChange(const CloseGroupChange& change);
+  // Keeps 'node' if our routing table holds or will add it, dropping any peer the table drops in
+  // its place.  Returns whether 'node' was kept.
+  bool InsertPeer(std::unique_ptr<PeerNode> node);
+  // True if we're not connected to 'their_id' but our routing table would add it, or holds it
+  // already (having promoted it from the table's replacement cache).
+  bool Wanted(const Address& their_id) const;
+  void ConnectToReplacements(std::vector<typename Table::Replacement> replacements);
+  // Removes the peer from 'index_' and destroys it (closing its socket), leaving its entries in
+  // 'peers_' to be erased by 'EraseDestroyedPeers'.  Returns false if the peer isn't held.
+  bool DestroyPeer(const Address& their_id);
+  // Adds 'node' to the peers, returning it in place, or null if its ID is already held.
+  PeerNode* StorePeer(std::unique_ptr<PeerNode> node);
+  // The position 'their_id' has, or would have, in the peers.
+  size_t PeerPosition(const Address& their_id) const;
+  // Erases the null entries left in 'peers_' by destroyed peers, keeping the rest in order.
+  void EraseDestroyedPeers();
+  void UpdateCloseGroupRadius();
   std::weak_ptr<boost::none_t> DestroyGuard() { return destroy_indicator_; }
   void StartReceiving(PeerNode&);
+  // 'AddNode' for a node whose socket belongs on another shard: the connection and handshake are
+  // made there, and the result posted back to the control shard.
+  template <typename Handler>
+  void AddNodeOnShard(size_t shard, NodeInfo assumed_node_info, EndpointPair, Handler handler);
+  // Completes 'AddNode' once the handshake has given us 'their_public_pmid'.
+  template <typename Handler>
+  void Connected(const boost::optional<NodeInfo>& assumed_node_info, EndpointPair,
+                 PublicPmid their_public_pmid, std::shared_ptr<crux::socket>, size_t shard,
+                 Handler handler);
 
  private:
   boost::asio::io_service& io_service_;
+  IoShards* shards_;
 
   std::function<void(Address)> on_connection_added_;
-  std::function<void(Address, const SerialisedMessage&)> on_receive_;
+  std::function<void(Address, SerialisedMessage)> on_receive_;
 
   PublicPmid our_fob_;
   Address our_id_;
 
   std::map<unsigned short, std::unique_ptr<crux::acceptor>> acceptors_;  // NOLINT
   std::map<crux::endpoint, std::shared_ptr<crux::socket>> being_connected_;
-  std::map<Address, PeerNode, Comparison> peers_;
+  // The peers in order of distance from us.  'distances_[i]' is the distance of 'peers_[i]', held
+  // separately so that ordered searches scan a dense array.  The peers themselves are on the heap
+  // so that they stay put while receiving.  'index_' finds a peer by ID.
+  std::vector<XorDistance> distances_;
+  std::vector<std::unique_ptr<PeerNode>> peers_;
+  std::unordered_map<Address, PeerNode*, AddressHash> index_;
+  std::unique_ptr<Table> routing_table_;
 
   std::vector<Address> current_close_group_;
+  // Set when a peer is stored or destroyed within the first 'GroupSize' positions.
+  bool close_group_changed_;
+  XorDistance close_group_radius_;
+
+  std::function<void(CloseGroupChange)> on_close_group_changed_;
+  std::chrono::steady_clock::duration close_group_change_window_;
+  CloseGroupChange pending_close_group_change_;
+  boost::asio::steady_timer close_group_change_timer_;
+  bool close_group_change_pending_;
+  boost::optional<BatchingOptions> batching_;
+
+  const std::chrono::steady_clock::time_point started_;
+  boost::optional<std::chrono::steady_clock::duration> time_to_full_close_group_;
 
   std::shared_ptr<boost::none_t> destroy_indicator_;
 };
 
+using ConnectionManager = BasicConnectionManager<DefaultNetworkParameters>;
+
+template <typename NetworkParameters>
+BasicConnectionManager<NetworkParameters>::BasicConnectionManager(boost::asio::io_service& ios,
+                                                          PublicPmid our_fob)
+    : io_service_(ios),
+      shards_(nullptr),
+      our_fob_(std::move(our_fob)),
+      our_id_(our_fob_.Name()),
+      distances_(),
+      peers_(),
+      index_(),
+      routing_table_(maidsafe::make_unique<Table>(our_id_)),
+      current_close_group_(),
+      close_group_changed_(false),
+      close_group_radius_(),
+      on_close_group_changed_(),
+      close_group_change_window_(),
+      pending_close_group_change_(),
+      close_group_change_timer_(ios),
+      close_group_change_pending_(false),
+      batching_(),
+      started_(std::chrono::steady_clock::now()),
+      time_to_full_close_group_(),
+      destroy_indicator_(new boost::none_t()) {
+  UpdateCloseGroupRadius();
+}
+
+template <typename NetworkParameters>
+BasicConnectionManager<NetworkParameters>::BasicConnectionManager(IoShards& shards,
+                                                                  PublicPmid our_fob)
+    : BasicConnectionManager(shards.Control().service(), std::move(our_fob)) {
+  shards_ = &shards;
+}
+
+template <typename NetworkParameters>
+bool BasicConnectionManager<NetworkParameters>::IsManaged(const Address& node_id) const {
+  return index_.count(node_id) != 0;
+  // return routing_table_.CheckNode(node_to_add);
+}
+
+template <typename NetworkParameters>
+typename BasicConnectionManager<NetworkParameters>::Targets
+BasicConnectionManager<NetworkParameters>::GetTarget(const Address& target) const {
+  Targets targets;
+  auto& chosen(targets.addresses_);
+  auto& count(targets.size_);
+
+  // the peers are ordered by distance from us, so our close group is the first 'GroupSize'
+  if (AddressInCloseGroupRange(target)) {
+    for (size_t i(0); i < std::min(peers_.size(), CloseGroupSize()); ++i) {
+      if (peers_[i]->node_info().connected)
+        chosen[count++] = &peers_[i]->id();
+    }
+    return targets;
+  }
+
+  // select the 'Parallelism' connected peers closest to target, holding them in 'chosen' in order
+  // of closeness to target.  Peers sharing a longer prefix with target are closer to it.  As the
+  // peers are ordered by distance from us, and XOR with our ID preserves common prefixes, the
+  // peers sharing at least any given prefix with target form a run around target's own position.
+  // So walk outwards from there in order of decreasing prefix, stopping once no peer left could
+  // displace those chosen.  Distances from us stand in for addresses throughout.
+  const size_t parallelism(NetworkParameters::Parallelism);
+  const auto target_distance(XorDistanceBetween(our_id_, target));
+  std::array<size_t, NetworkParameters::Parallelism> closest;
+  auto closer([&](size_t lhs, size_t rhs) {
+    return XorCloser(distances_[lhs], distances_[rhs], target_distance);
+  });
+  auto prefix([&](size_t i) { return XorCommonLeadingBits(distances_[i], target_distance); });
+  size_t right(PeerPosition(target)), left(right);
+  int32_t right_prefix(right == distances_.size() ? -1 : prefix(right));
+  int32_t left_prefix(left == 0 ? -1 : prefix(left - 1));
+  while (right_prefix >= 0 || left_prefix >= 0) {
+    if (count == parallelism && std::max(right_prefix, left_prefix) < prefix(closest[count - 1]))
+      break;
+    size_t peer;
+    if (right_prefix >= left_prefix) {
+      peer = right++;
+      right_prefix = right == distances_.size() ? -1 : prefix(right);
+    } else {
+      peer = --left;
+      left_prefix = left == 0 ? -1 : prefix(left - 1);
+    }
+    if (!peers_[peer]->node_info().connected ||
+        (count == parallelism && !closer(peer, closest[count - 1]))) {
+      continue;
+    }
+    auto position(count < parallelism ? count++ : count - 1);
+    for (; position > 0 && closer(peer, closest[position - 1]); --position)
+      closest[position] = closest[position - 1];
+    closest[position] = peer;
+  }
+  for (size_t i(0); i < count; ++i)
+    chosen[i] = &peers_[closest[i]]->id();
+  return targets;
+}
+
+// boost::optional<CloseGroupChange> ConnectionManager::LostNetworkConnection(
+//    const Address& node) {
+//  routing_table_.DropNode(node);
+//  return GroupChanged();
+// }
+
+template <typename NetworkParameters>
+boost::optional<CloseGroupChange> BasicConnectionManager<NetworkParameters>::DropNode(
+    const Address& their_id) {
+  return DropNodes(std::vector<Address>(1, their_id));
+}
+
+template <typename NetworkParameters>
+boost::optional<CloseGroupChange> BasicConnectionManager<NetworkParameters>::DropNodes(
+    const std::vector<Address>& their_ids) {
+  auto dropped_from_table(routing_table_->DropNodes(their_ids));
+  // destroy the dropped peers, then close up the gaps they leave in a single pass
+  bool dropped(false);
+  for (const auto& their_id : their_ids)
+    dropped = DestroyPeer(their_id) || dropped;
+  if (dropped)
+    EraseDestroyedPeers();
+  ConnectToReplacements(std::move(dropped_from_table.promoted));
+  return GroupChanged();
+}
+
+template <typename NetworkParameters>
+bool BasicConnectionManager<NetworkParameters>::DestroyPeer(const Address& their_id) {
+  if (index_.erase(their_id) == 0)
+    return false;
+  auto position(PeerPosition(their_id));
+  peers_[position].reset();
+  if (position < CloseGroupSize())
+    close_group_changed_ = true;
+  return true;
+}
+
+template <typename NetworkParameters>
+size_t BasicConnectionManager<NetworkParameters>::PeerPosition(const Address& their_id) const {
+  return static_cast<size_t>(std::lower_bound(distances_.begin(), distances_.end(),
+                                              XorDistanceBetween(our_id_, their_id)) -
+                             distances_.begin());
+}
+
+template <typename NetworkParameters>
+void BasicConnectionManager<NetworkParameters>::EraseDestroyedPeers() {
+  size_t kept(0);
+  for (size_t i(0); i < peers_.size(); ++i) {
+    if (!peers_[i])
+      continue;
+    if (kept != i) {
+      distances_[kept] = distances_[i];
+      peers_[kept] = std::move(peers_[i]);
+    }
+    ++kept;
+  }
+  distances_.resize(kept);
+  peers_.resize(kept);
+  UpdateCloseGroupRadius();
+}
+
+// acceptor_(io_service_, crux::endpoint(boost::asio::ip::udp::v4(), 5483)),
+template <typename NetworkParameters>
+void BasicConnectionManager<NetworkParameters>::StartAccepting(unsigned short port) {
+  auto acceptor_i = acceptors_.find(port);
+
+  if (acceptor_i == acceptors_.end()) {
+    crux::endpoint endpoint(boost::asio::ip::udp::v4(), port);
+    auto acceptor = std::unique_ptr<crux::acceptor>(new crux::acceptor(io_service_, endpoint));
+    auto pair = acceptors_.insert(std::make_pair(port, std::move(acceptor)));
+    acceptor_i = pair.first;
+  }
+
+  auto socket = std::make_shared<crux::socket>(io_service_);
+
+  auto& acceptor = acceptor_i->second;
+
+  std::weak_ptr<boost::none_t> destroy_guard = destroy_indicator_;
+
+  acceptor->async_accept(*socket, [=](boost::system::error_code error) {
+    if (!destroy_guard.lock())
+      return;
+
+    if (error) {
+      if (error == boost::asio::error::operation_aborted) {
+        return;
+      }
+    }
+
+    StartAccepting(port);
+
+    AsyncExchange(*socket, Serialise(our_fob_),
+                  [=](boost::system::error_code error, SerialisedMessage data) {
+      if (!destroy_guard.lock())
+        return;
+
+      if (error)
+        return;
+
+      PublicPmid their_public_pmid(Parse<PublicPmid>(std::move(data)));
+      Address their_id(their_public_pmid.Name());
+      // The endpoint the peer connected from isn't the one it accepts connections on, so we don't
+      // know where to reach it.
+      InsertPeer(maidsafe::make_unique<PeerNode>(
+          NodeInfo(std::move(their_id), std::move(their_public_pmid), true), std::move(socket)));
+    });
+  });
+}
+
+template <typename NetworkParameters>
+void BasicConnectionManager<NetworkParameters>::AddNode(boost::optional<NodeInfo> assumed_node_info,
+                                                        EndpointPair eps) {
+  AddNode(std::move(assumed_node_info), std::move(eps), [](asio::error_code) {});
+}
+
+template <typename NetworkParameters>
+template <typename Handler>
+void BasicConnectionManager<NetworkParameters>::AddNode(boost::optional<NodeInfo> assumed_node_info,
+                                                        EndpointPair eps, Handler handler) {
+  static const crux::endpoint unspecified_ep(boost::asio::ip::udp::v4(), 0);
+  std::weak_ptr<boost::none_t> destroy_guard = destroy_indicator_;
+
+  if (assumed_node_info && !Wanted(assumed_node_info->id)) {
+    io_service_.post([=]() {
+      if (destroy_guard.lock())
+        handler(asio::error::connection_refused);
+    });
+    return;
+  }
+
+  if (assumed_node_info && shards_) {
+    auto shard(shards_->ShardOf(assumed_node_info->id));
+    if (shard != 0)
+      return AddNodeOnShard(shard, std::move(*assumed_node_info), std::move(eps), handler);
+  }
+
+  // TODO(PeterJ): Try the internal endpoint as well
+  auto endpoint = convert::ToBoost(eps.external);
+
+  auto pair_i = being_connected_.find(endpoint);
+
+  if (pair_i == being_connected_.end()) {
+    bool inserted = false;
+    auto socket = std::make_shared<crux::socket>(io_service_, unspecified_ep);
+    std::tie(pair_i, inserted) = being_connected_.insert(std::make_pair(endpoint, socket));
+  }
+
+  auto socket = pair_i->second;
+  std::weak_ptr<crux::socket> weak_socket = socket;
+  // The socket is shared with any other attempt on the same endpoint, so is gone if that attempt
+  // failed first.  The handler must still be told, so that callers such as 'Reconnect' complete.
+  auto abandoned = [=]() {
+    if (destroy_guard.lock())
+      handler(asio::error::operation_aborted);
+  };
+
+  socket->async_connect(convert::ToBoost(eps.external), [=](boost::system::error_code error) {
+    auto socket = weak_socket.lock();
+
+    if (!socket)
+      return abandoned();
+
+    if (error) {
+      being_connected_.erase(endpoint);
+      return handler(convert::ToStd(error));
+    }
+
+    AsyncExchange(*socket, Serialise(our_fob_),
+                  [=](boost::system::error_code error, SerialisedMessage data) {
+      auto socket = weak_socket.lock();
+
+      if (!socket)
+        return abandoned();
+
+      being_connected_.erase(endpoint);
+
+      if (error)
+        return handler(convert::ToStd(error));
+
+      Connected(assumed_node_info, eps, Parse<PublicPmid>(std::move(data)), std::move(socket), 0,
+                handler);
+    });
+  });
+}
+
+template <typename NetworkParameters>
+template <typename Handler>
+void BasicConnectionManager<NetworkParameters>::AddNodeOnShard(size_t shard,
+                                                               NodeInfo assumed_node_info,
+                                                               EndpointPair eps, Handler handler) {
+  std::weak_ptr<boost::none_t> destroy_guard = destroy_indicator_;
+  IoShard* io_shard(&(*shards_)[shard]);
+  IoShard* control(&shards_->Control());
+  auto our_serialised_fob(Serialise(our_fob_));
+  io_shard->Post([=]() {
+    // TODO(PeterJ): Try the internal endpoint as well
+    auto socket(std::make_shared<crux::socket>(io_shard->service(),
+                                               crux::endpoint(boost::asio::ip::udp::v4(), 0)));
+    auto failed = [=](boost::system::error_code error) {
+      io_shard->Release(socket);
+      control->Post([=]() {
+        if (destroy_guard.lock())
+          handler(convert::ToStd(error));
+      });
+    };
+    socket->async_connect(convert::ToBoost(eps.external), [=](boost::system::error_code error) {
+      if (error)
+        return failed(error);
+
+      AsyncExchange(*socket, our_serialised_fob,
+                    [=](boost::system::error_code error, SerialisedMessage data) {
+        if (error)
+          return failed(error);
+        auto shared_data(std::make_shared<SerialisedMessage>(std::move(data)));
+        control->Post([=]() {
+          if (!destroy_guard.lock())
+            return io_shard->Release(socket);
+          Connected(boost::optional<NodeInfo>(assumed_node_info), eps,
+                    Parse<PublicPmid>(std::move(*shared_data)), socket, shard, handler);
+        });
+      });
+    });
+  });
+}
+
+template <typename NetworkParameters>
+template <typename Handler>
+void BasicConnectionManager<NetworkParameters>::Connected(
+    const boost::optional<NodeInfo>& assumed_node_info, EndpointPair eps,
+    PublicPmid their_public_pmid, std::shared_ptr<crux::socket> socket, size_t shard,
+    Handler handler) {
+  Address their_id(their_public_pmid.Name());
+  NodeInfo their_node_info(std::move(their_id), std::move(their_public_pmid), true);
+  // The peer takes the socket even if it's refused, so it's released on the right shard.
+  auto peer(maidsafe::make_unique<PeerNode>(std::move(their_node_info), std::move(socket),
+                                            std::move(eps), shards_, shard));
+
+  if (assumed_node_info && *assumed_node_info != peer->node_info())
+    return handler(asio::error::connection_refused);
+
+  if (!InsertPeer(std::move(peer)))
+    return handler(asio::error::connection_refused);
+  handler(asio::error_code());
+}
+
+template <typename NetworkParameters>
+PeerSnapshot BasicConnectionManager<NetworkParameters>::Snapshot() const {
+  PeerSnapshot peers;
+  peers.reserve(peers_.size());
+  for (const auto& peer_ptr : peers_) {
+    const auto& peer(*peer_ptr);
+    if (!IsSet(peer.endpoint_pair()))
+      continue;
+    peers.push_back(PeerSnapshotEntry{peer.node_info(), peer.endpoint_pair(), peer.last_seen()});
+  }
+  return peers;
+}
+
+template <typename NetworkParameters>
+template <typename Handler>
+void BasicConnectionManager<NetworkParameters>::Reconnect(PeerSnapshot peers, Handler handler) {
+  if (peers.empty())
+    return handler(size_t{0});
+
+  struct Progress {
+    size_t outstanding;
+    size_t connected;
+  };
+  auto progress(std::make_shared<Progress>(Progress{peers.size(), 0}));
+  for (auto& peer : peers) {
+    AddNode(std::move(peer.node_info), std::move(peer.endpoint_pair),
+            [progress, handler](asio::error_code error) {
+      if (!error)
+        ++progress->connected;
+      if (--progress->outstanding == 0)
+        handler(progress->connected);
+    });
+  }
+}
+
+template <typename NetworkParameters>
+bool BasicConnectionManager<NetworkParameters>::InsertPeer(std::unique_ptr<PeerNode> node_arg) {
+  if (index_.count(node_arg->id()) != 0)
+    return false;
+
+  // a peer the table already holds was promoted from its replacement cache, so is expected
+  if (!routing_table_->GetPublicKey(node_arg->id())) {
+    auto added(routing_table_->AddNode(node_arg->node_info(), node_arg->endpoint_pair()));
+    if (!added.first)
+      return false;  // 'node_arg' is destroyed on return, closing its socket
+    if (added.second && DestroyPeer(added.second->id))
+      EraseDestroyedPeers();
+  }
+
+  auto stored(StorePeer(std::move(node_arg)));
+
+  if (!stored) {
+    return false;
+  }
+
+  auto& node = *stored;
+  if (batching_)
+    node.EnableBatching(*batching_);
+
+  UpdateCloseGroupRadius();
+  GroupChanged();
+  StartReceiving(node);
+
+  if (!time_to_full_close_group_ && peers_.size() >= CloseGroupSize()) {
+    time_to_full_close_group_ = std::chrono::steady_clock::now() - started_;
+    LOG(kInfo) << "Close group full after "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      *time_to_full_close_group_).count() << " ms";
+  }
+
+  if (on_connection_added_) {
+    on_connection_added_(node.id());
+  }
+  return true;
+}
+
+template <typename NetworkParameters>
+PeerNode* BasicConnectionManager<NetworkParameters>::StorePeer(std::unique_ptr<PeerNode> node) {
+  if (index_.count(node->id()) != 0)
+    return nullptr;
+
+  auto position(PeerPosition(node->id()));
+  if (position < CloseGroupSize())
+    close_group_changed_ = true;
+  distances_.insert(distances_.begin() + position, XorDistanceBetween(our_id_, node->id()));
+  peers_.insert(peers_.begin() + position, std::move(node));
+  auto stored(peers_[position].get());
+  index_.insert(std::make_pair(stored->id(), stored));
+  return stored;
+}
+
+template <typename NetworkParameters>
+bool BasicConnectionManager<NetworkParameters>::Wanted(const Address& their_id) const {
+  return index_.count(their_id) == 0 &&
+         (routing_table_->CheckNode(their_id) || routing_table_->GetPublicKey(their_id));
+}
+
+// Replacements are added to the routing table when promoted, so are dropped from it again (in turn
+// promoting others) if they can't be connected to, unless they've since connected to us.
+template <typename NetworkParameters>
+void BasicConnectionManager<NetworkParameters>::ConnectToReplacements(
+    std::vector<typename Table::Replacement> replacements) {
+  for (auto& replacement : replacements) {
+    auto their_id(replacement.node_info.id);
+    AddNode(std::move(replacement.node_info), std::move(replacement.endpoint_pair),
+            [=](asio::error_code error) {
+      if (!error || index_.count(their_id) != 0)
+        return;
+      auto promoted(routing_table_->DropNode(their_id));
+      if (promoted)
+        ConnectToReplacements(std::vector<typename Table::Replacement>(1, std::move(*promoted)));
+    });
+  }
+}
+
+template <typename NetworkParameters>
+void BasicConnectionManager<NetworkParameters>::StartReceiving(PeerNode& node) {
+  auto node_guard = node.DestroyGuard();
+
+  node.Receive([=, &node](asio::error_code error, SerialisedMessage bytes) {
+    if (!node_guard.lock())
+      return;
+    if (error)
+      return;
+    if (!on_receive_)
+      return;
+    std::vector<SerialisedMessage> messages;
+    if (IsBatchFrame(bytes)) {
+      try {
+        messages = ParseBatchFrame(bytes);
+      } catch (const std::exception& e) {
+        LOG(kWarning) << "Discarding malformed batch frame from " << HexSubstr(node.id().string())
+                      << ": " << e.what();
+      }
+    } else {
+      messages.push_back(std::move(bytes));
+    }
+    // Complex handler invocation to be safe in cases where the
+    // handler destroys this object or in case where the handler
+    // invocation resets the handler to something else.
+    const auto their_id(node.id());
+    auto h = std::move(on_receive_);
+    for (auto& message : messages) {
+      h(their_id, std::move(message));
+      if (!node_guard.lock())
+        return;
+    }
+    if (!on_receive_) {
+      on_receive_ = std::move(h);
+    }
+    StartReceiving(node);
+  });
+}
+
+// bool ConnectionManager::CloseGroupMember(const Address& their_id) {
+//  auto close_group(routing_table_.OurCloseGroup());
+//  return std::any_of(std::begin(close_group), std::end(close_group),
+//                     [&their_id](const NodeInfo& node) { return node.id == their_id; });
+// }
+
+template <typename NetworkParameters>
+void BasicConnectionManager<NetworkParameters>::UpdateCloseGroupRadius() {
+  if (peers_.size() < CloseGroupSize()) {
+    close_group_radius_.fill(std::numeric_limits<XorDistance::value_type>::max());
+    return;
+  }
+  close_group_radius_ = distances_[CloseGroupSize() - 1];
+}
+
+template <typename NetworkParameters>
+boost::optional<CloseGroupChange> BasicConnectionManager<NetworkParameters>::GroupChanged() {
+  if (!close_group_changed_)
+    return boost::none;
+  close_group_changed_ = false;
+
+  // Both the old and new groups are in order of distance from us, so a single merge of the two
+  // finds the difference.
+  const size_t new_size(std::min(peers_.size(), CloseGroupSize()));
+  CloseGroupChange change;
+  size_t old_i(0), new_i(0);
+  while (old_i < current_close_group_.size() || new_i < new_size) {
+    if (new_i == new_size) {
+      change.removed.push_back(current_close_group_[old_i++]);
+    } else if (old_i == current_close_group_.size()) {
+      change.added.push_back(peers_[new_i++]->id());
+    } else if (current_close_group_[old_i] == peers_[new_i]->id()) {
+      ++old_i;
+      ++new_i;
+    } else if (XorDistanceBetween(our_id_, current_close_group_[old_i]) < distances_[new_i]) {
+      change.removed.push_back(current_close_group_[old_i++]);
+    } else {
+      change.added.push_back(peers_[new_i++]->id());
+    }
+  }
+  if (change.empty())
+    return boost::none;
+
+  current_close_group_.resize(new_size);
+  for (size_t i(0); i < new_size; ++i)
+    current_close_group_[i] = peers_[i]->id();
+  QueueCloseGroupChange(change);
+  return std::move(change);
+}
+
+template <typename NetworkParameters>
+void BasicConnectionManager<NetworkParameters>::QueueCloseGroupChange(
+    const CloseGroupChange& change) {
+  if (!on_close_group_changed_)
+    return;
+
+  // A node which is added then removed (or removed then added) within the window cancels out.
+  auto& pending(pending_close_group_change_);
+  auto merge = [](const std::vector<Address>& ids, std::vector<Address>& cancelled_by,
+                  std::vector<Address>& appended_to) {
+    for (const auto& id : ids) {
+      auto found(std::find(cancelled_by.begin(), cancelled_by.end(), id));
+      if (found != cancelled_by.end())
+        cancelled_by.erase(found);
+      else
+        appended_to.push_back(id);
+    }
+  };
+  merge(change.added, pending.removed, pending.added);
+  merge(change.removed, pending.added, pending.removed);
+
+  if (close_group_change_pending_)
+    return;
+  close_group_change_pending_ = true;
+  std::weak_ptr<boost::none_t> destroy_guard = destroy_indicator_;
+  close_group_change_timer_.expires_from_now(close_group_change_window_);
+  close_group_change_timer_.async_wait([=](const boost::system::error_code& error) {
+    if (!destroy_guard.lock() || error == boost::asio::error::operation_aborted)
+      return;
+    close_group_change_pending_ = false;
+    CloseGroupChange notified;
+    std::swap(notified, pending_close_group_change_);
+    if (!notified.empty() && on_close_group_changed_)
+      on_close_group_changed_(std::move(notified));
+  });
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
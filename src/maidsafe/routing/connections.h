@@ -34,6 +34,7 @@
 
 #include "maidsafe/routing/async_queue.h"
 #include "maidsafe/routing/async_exchange.h"
+#include "maidsafe/routing/buffer_pool.h"
 #include "maidsafe/routing/types.h"
 
 namespace maidsafe {
@@ -56,6 +57,9 @@ class Connections {
   template <class Handler /* void (error_code) */>
   void Send(const Address&, const SerialisedMessage&, Handler);
 
+  template <class Handler /* void (error_code) */>
+  void Send(const Address&, SharedMessage, Handler);
+
   template <class Handler /* void (error_code, Address, const SerialisedMessage&) */>
   void Receive(Handler);
 
@@ -97,6 +101,11 @@ inline Connections::Connections(boost::asio::io_service& ios, const Address& our
 
 template <class Handler /* void (error_code) */>
 void Connections::Send(const Address& remote_id, const SerialisedMessage& bytes, Handler handler) {
+  Send(remote_id, MakeSharedMessage(bytes), std::move(handler));
+}
+
+template <class Handler /* void (error_code) */>
+void Connections::Send(const Address& remote_id, SharedMessage bytes, Handler handler) {
   service_.post([=]() {
     auto remote_endpoint_i = id_to_endpoint_map_.find(remote_id);
 
@@ -109,13 +118,12 @@ void Connections::Send(const Address& remote_id, const SerialisedMessage& bytes,
     assert(socket_i != connections_.end());
 
     auto& socket = socket_i->second;
-    auto buffer = std::make_shared<SerialisedMessage>(std::move(bytes));
 
     std::weak_ptr<crux::socket> weak_socket = socket;
 
-    socket->async_send(boost::asio::buffer(*buffer),
+    socket->async_send(boost::asio::buffer(*bytes),
                        [=](boost::system::error_code error, std::size_t) {
-                         static_cast<void>(buffer);
+                         static_cast<void>(bytes);
 
                          if (!weak_socket.lock()) {
                            return handler(asio::error::operation_aborted);
@@ -252,15 +260,16 @@ inline void Connections::StartReceiving(const Address& id, const crux::endpoint&
                                         const std::shared_ptr<crux::socket>& socket) {
   std::weak_ptr<crux::socket> weak_socket = socket;
 
-  // TODO(PeterJ): Buffer reuse
-  auto buffer = std::make_shared<SerialisedMessage>(max_message_size());
+  auto buffer =
+      std::make_shared<BufferPool::Buffer>(SharedBufferPool().Borrow(max_message_size()));
 
   socket->async_receive(
-      boost::asio::buffer(*buffer), [=](boost::system::error_code error, size_t size) {
+      boost::asio::buffer(buffer->data(), buffer->size()),
+      [=](boost::system::error_code error, size_t size) {
         auto socket = weak_socket.lock();
 
         if (!socket) {
-          return receive_queue_.Push(asio::error::operation_aborted, id, std::move(*buffer));
+          return receive_queue_.Push(asio::error::operation_aborted, id, SerialisedMessage());
         }
 
         if (error) {
@@ -268,8 +277,9 @@ inline void Connections::StartReceiving(const Address& id, const crux::endpoint&
           connections_.erase(remote_endpoint);
         }
 
-        buffer->resize(size);
-        receive_queue_.Push(convert::ToStd(error), id, std::move(*buffer));
+        SerialisedMessage bytes(buffer->data(), buffer->data() + (error ? 0 : size));
+        buffer->Release();
+        receive_queue_.Push(convert::ToStd(error), id, std::move(bytes));
 
         if (error)
           return;
@@ -0,0 +1,81 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/io_shards.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "maidsafe/common/make_unique.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+IoShard::IoShard()
+    : service_(1),
+      work_(maidsafe::make_unique<boost::asio::io_service::work>(service_)),
+      tasks_(),
+      drain_posted_(false),
+      tasks_run_(0),
+      thread_([this] { service_.run(); }) {}
+
+IoShard::~IoShard() { Stop(); }
+
+void IoShard::Post(std::function<void()> task) {
+  tasks_.Push(std::move(task));
+  // The exchange orders the push before the check, so either this call posts a drain or the
+  // pending one (which clears the flag before popping) will find the task.
+  if (!drain_posted_.exchange(true, std::memory_order_acq_rel))
+    service_.post([this] { Drain(); });
+}
+
+void IoShard::Drain() {
+  drain_posted_.exchange(false, std::memory_order_acq_rel);
+  std::function<void()> task;
+  while (tasks_.Pop(task)) {
+    task();
+    task = nullptr;
+    ++tasks_run_;
+  }
+}
+
+void IoShard::Stop() {
+  if (!thread_.joinable())
+    return;
+  work_.reset();
+  service_.stop();
+  thread_.join();
+}
+
+IoShards::IoShards(size_t count) : shards_() {
+  shards_.reserve(std::max(count, size_t{1}));
+  while (shards_.size() < std::max(count, size_t{1}))
+    shards_.push_back(maidsafe::make_unique<IoShard>());
+}
+
+void IoShards::Stop() {
+  for (auto& shard : shards_)
+    shard->Stop();
+}
+
+size_t IoShards::DefaultCount() { return std::max(std::thread::hardware_concurrency(), 1U); }
+
+}  // namespace routing
+
+}  // namespace maidsafe
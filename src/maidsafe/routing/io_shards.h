@@ -0,0 +1,114 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_IO_SHARDS_H_
+#define MAIDSAFE_ROUTING_IO_SHARDS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+
+#include "maidsafe/routing/mpsc_queue.h"
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// An io_service with its own thread.  Work is handed to it with 'Post', which pushes onto a
+// lock-free queue; the io_service is only posted to when the queue goes from idle to busy, so a
+// burst of tasks from other threads costs one trip through the io_service's own (locked) queue.
+// Tasks posted from any one thread run in the order they were posted.
+class IoShard {
+ public:
+  IoShard();
+  IoShard(const IoShard&) = delete;
+  IoShard(IoShard&&) = delete;
+  IoShard& operator=(const IoShard&) = delete;
+  IoShard& operator=(IoShard&&) = delete;
+  ~IoShard();
+
+  boost::asio::io_service& service() { return service_; }
+
+  void Post(std::function<void()> task);
+
+  // Hands 'object' to this shard's thread to be destroyed there.  Sockets must be destroyed on the
+  // thread running their io_service.
+  template <typename T>
+  void Release(std::shared_ptr<T> object) {
+    if (object)
+      Post([object]() {});  // NOLINT
+  }
+
+  bool RunningInThisThread() const { return std::this_thread::get_id() == thread_.get_id(); }
+
+  // Stops the thread, discarding any tasks not yet run.  Must not be called from this shard.
+  void Stop();
+
+  // The number of tasks which have been run.
+  uint64_t TasksRun() const { return tasks_run_; }
+
+ private:
+  void Drain();
+
+  boost::asio::io_service service_;
+  std::unique_ptr<boost::asio::io_service::work> work_;
+  MpscQueue<std::function<void()>> tasks_;
+  std::atomic<bool> drain_posted_;
+  std::atomic<uint64_t> tasks_run_;
+  std::thread thread_;
+};
+
+// A fixed set of 'IoShard's for socket I/O.  Each peer's socket is placed on the shard its ID
+// hashes to, so the sockets' work is spread over the threads.  Shard 0 is the control shard: the
+// routing state (the connection manager, caches and filters) is only touched from it, so a task
+// on another shard which needs that state posts back to 'Control()'.  With a single shard all
+// work runs on the control shard, as if unsharded.
+class IoShards {
+ public:
+  explicit IoShards(size_t count);
+  IoShards(const IoShards&) = delete;
+  IoShards(IoShards&&) = delete;
+  IoShards& operator=(const IoShards&) = delete;
+  IoShards& operator=(IoShards&&) = delete;
+  ~IoShards() = default;
+
+  size_t Count() const { return shards_.size(); }
+  IoShard& operator[](size_t index) { return *shards_[index]; }
+  IoShard& Control() { return *shards_.front(); }
+  size_t ShardOf(const Address& id) const { return AddressHash()(id) % shards_.size(); }
+
+  void Stop();
+
+  // One shard per hardware thread.
+  static size_t DefaultCount();
+
+ private:
+  std::vector<std::unique_ptr<IoShard>> shards_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_IO_SHARDS_H_
@@ -0,0 +1,60 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_buffers.h"
+
+#include <cstdint>
+
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/common/error.h"
+
+#include "maidsafe/routing/messages/get_data_response.h"
+#include "maidsafe/routing/messages/put_data.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The prefixes below stop where the body's data bytes would start, so rely on the binary archive
+// writing a byte vector as a 64-bit size followed by the bytes, and a set optional as 'true'
+// followed by its value.  The tests check the buffers against 'Serialise' of the whole message.
+
+SharedBuffers PutDataBuffers(const MessageHeader& header, MessageTypeTag tag, DataTypeId type_id,
+                             SharedMessage data, HeaderEncoding encoding) {
+  auto size(static_cast<std::uint64_t>(data->size()));
+  return SharedBuffers{
+      MakeSharedMessage(detail::SerialiseWithHeader(header, encoding, tag, type_id, size)),
+      std::move(data)};
+}
+
+SharedBuffers GetDataResponseBuffers(const MessageHeader& header,
+                                     Data::NameAndTypeId name_and_type_id, SharedMessage data,
+                                     HeaderEncoding encoding) {
+  auto size(static_cast<std::uint64_t>(data->size()));
+  const bool has_data(true);
+  const boost::optional<maidsafe_error> no_error;
+  return SharedBuffers{MakeSharedMessage(detail::SerialiseWithHeader(
+                           header, encoding, MessageTypeTag::GetDataResponse, name_and_type_id,
+                           has_data, size)),
+                       std::move(data), MakeSharedMessage(Serialise(no_error))};
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,97 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_BUFFERS_H_
+#define MAIDSAFE_ROUTING_MESSAGE_BUFFERS_H_
+
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/data_types/data.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+
+#include "maidsafe/routing/compact_header.h"
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/messages/messages_fwd.h"
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// These serialise a message for 'PeerNode::Send' as separate buffers.  Except where noted, their
+// concatenation is exactly 'Serialise(header, tag, body)', so the receiver parses it as usual.
+// With 'HeaderEncoding::compact' the header is instead in the compact encoding (see
+// 'SerialiseCompactHeader'), followed by the same bytes; 'MessageView' reads either encoding.
+
+enum class HeaderEncoding { cereal, compact };
+
+// The serialised header and tag, then the serialised body.
+template <typename Body>
+SharedBuffers SerialiseBuffers(const MessageHeader& header, MessageTypeTag tag, const Body& body,
+                               HeaderEncoding encoding = HeaderEncoding::cereal);
+
+// As 'SerialiseBuffers' with 'HeaderEncoding::compact'.
+template <typename Body>
+SharedBuffers SerialiseCompactBuffers(const MessageHeader& header, MessageTypeTag tag,
+                                      const Body& body);
+
+// As 'SerialiseBuffers(header, tag, PutData(type_id, *data))', but 'data' is its own buffer, so
+// is neither copied into a 'PutData' nor into the serialised message.  'tag' is 'PutData' or
+// 'Post', both of which carry a 'PutData' body.
+SharedBuffers PutDataBuffers(const MessageHeader& header, MessageTypeTag tag, DataTypeId type_id,
+                             SharedMessage data, HeaderEncoding encoding = HeaderEncoding::cereal);
+
+// As 'SerialiseBuffers(header, GetDataResponse tag, GetDataResponse(name_and_type_id, *data))',
+// with 'data' as its own buffer.
+SharedBuffers GetDataResponseBuffers(const MessageHeader& header,
+                                     Data::NameAndTypeId name_and_type_id, SharedMessage data,
+                                     HeaderEncoding encoding = HeaderEncoding::cereal);
+
+namespace detail {
+
+// 'Serialise(header, fields...)', with the header in the given encoding.
+template <typename... Fields>
+SerialisedMessage SerialiseWithHeader(const MessageHeader& header, HeaderEncoding encoding,
+                                      const Fields&... fields) {
+  if (encoding == HeaderEncoding::cereal)
+    return Serialise(header, fields...);
+  auto serialised(SerialiseCompactHeader(header));
+  const auto serialised_fields(Serialise(fields...));
+  serialised.insert(serialised.end(), serialised_fields.begin(), serialised_fields.end());
+  return serialised;
+}
+
+}  // namespace detail
+
+template <typename Body>
+SharedBuffers SerialiseBuffers(const MessageHeader& header, MessageTypeTag tag, const Body& body,
+                               HeaderEncoding encoding) {
+  return SharedBuffers{MakeSharedMessage(detail::SerialiseWithHeader(header, encoding, tag)),
+                       MakeSharedMessage(Serialise(body))};
+}
+
+template <typename Body>
+SharedBuffers SerialiseCompactBuffers(const MessageHeader& header, MessageTypeTag tag,
+                                      const Body& body) {
+  return SerialiseBuffers(header, tag, body, HeaderEncoding::compact);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_BUFFERS_H_
@@ -116,7 +116,7 @@ class MessageHeader {
   boost::optional<asymm::Signature> Signature() const { return signature_; }
   NodeAddress FromNode() const { return source_.node_address; }
   boost::optional<GroupAddress> FromGroup() const { return source_.group_address; }
-  Authority FromAuthority() { return authority_; }
+  Authority FromAuthority() const { return authority_; }
   bool RelayedMessage() const { return static_cast<bool>(source_.reply_to_address); }
   boost::optional<routing::ReplyToAddress> ReplyToAddress() const {
     return source_.reply_to_address;
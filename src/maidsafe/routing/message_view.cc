@@ -0,0 +1,149 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_view.h"
+
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Reads fields as the binary archive writes them: integers in native byte order, optionals as a
+// presence byte then the value, and strings (so addresses and the signature) as a 64-bit size
+// then the bytes.
+class Reader {
+ public:
+  Reader(const SerialisedMessage& bytes, std::size_t offset)
+      : in_(bytes.data() + offset), end_(bytes.data() + bytes.size()) {}
+
+  template <typename Integer>
+  Integer Read() {
+    Integer value;
+    std::memcpy(&value, Take(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  bool ReadPresence() {
+    auto present(Read<std::uint8_t>());
+    if (present > 1)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return present == 1;
+  }
+
+  // An unset address has no bytes.
+  Address ReadAddress() {
+    auto size(Read<std::uint64_t>());
+    if (size == 0)
+      return Address();
+    if (size != identity_size)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    auto data(Take(identity_size));
+    return Address(std::string(data, data + identity_size));
+  }
+
+  void SkipString() { Take(Read<std::uint64_t>()); }
+
+ private:
+  const byte* Take(std::uint64_t size) {
+    if (size > static_cast<std::uint64_t>(end_ - in_))
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    auto taken(in_);
+    in_ += size;
+    return taken;
+  }
+
+  const byte* in_;
+  const byte* const end_;
+};
+
+}  // unnamed namespace
+
+MessageView::MessageView(SharedMessage message)
+    : message_(std::move(message)),
+      destination_(),
+      from_node_(),
+      reply_to_address_(),
+      message_id_(0),
+      tag_(),
+      compact_header_size_(0),
+      stream_(),
+      header_(),
+      body_parsed_(false) {
+  if (IsCompactHeader(*message_)) {
+    auto fields(ReadCompactHeaderFields(*message_));
+    destination_ = std::move(fields.destination);
+    from_node_ = std::move(fields.from_node);
+    reply_to_address_ = std::move(fields.reply_to_address);
+    message_id_ = fields.message_id;
+    compact_header_size_ = fields.size;
+    Reader reader(*message_, compact_header_size_);
+    tag_ = static_cast<MessageTypeTag>(reader.Read<std::underlying_type<MessageTypeTag>::type>());
+    return;
+  }
+
+  // The fields in the order 'MessageHeader' serialises them, followed by the tag.
+  Reader reader(*message_, 0);
+  destination_ = routing::Destination(reader.ReadAddress());
+  if (reader.ReadPresence())  // the destination's reply-to address
+    reader.ReadAddress();
+  from_node_ = NodeAddress(reader.ReadAddress());
+  if (reader.ReadPresence())  // the source group address
+    reader.ReadAddress();
+  if (reader.ReadPresence())
+    reply_to_address_ = routing::ReplyToAddress(reader.ReadAddress());
+  message_id_ = reader.Read<routing::MessageId>();
+  reader.Read<std::underlying_type<Authority>::type>();
+  if (reader.ReadPresence())  // the signature
+    reader.SkipString();
+  tag_ = static_cast<MessageTypeTag>(reader.Read<std::underlying_type<MessageTypeTag>::type>());
+}
+
+MessageHeader& MessageView::Header() {
+  if (!header_) {
+    MessageHeader header;
+    MessageTypeTag tag;
+    if (compact_header_size_ != 0) {
+      std::size_t size(0);
+      header = ParseCompactHeader(*message_, size);
+      // The tag and body are read in place, following the header.
+      stream_ = maidsafe::make_unique<InputVectorStream>(*message_);
+      stream_->seekg(static_cast<std::streamoff>(size));
+      Parse(*stream_, tag);
+    } else {
+      stream_ = maidsafe::make_unique<InputVectorStream>(*message_);
+      Parse(*stream_, header, tag);
+    }
+    if (tag != tag_ || header.MessageId() != message_id_ ||
+        header.Destination().first != destination_ || header.FromNode() != from_node_)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    header_ = std::move(header);
+  }
+  return *header_;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
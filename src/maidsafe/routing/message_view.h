@@ -0,0 +1,105 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_VIEW_H_
+#define MAIDSAFE_ROUTING_MESSAGE_VIEW_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/serialisation/binary_archive.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+
+#include "maidsafe/routing/compact_header.h"
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/messages/messages_fwd.h"
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A view of a received message which reads the fields needed to filter and forward it - the
+// destination, source and message ID - and its type, without parsing the header.  Those fields are
+// read in place: each is of fixed size, and its offset depends only on which of the header's
+// optional addresses are present.  The signature is skipped over rather than copied.  The header
+// may be in either the cereal or the compact encoding (see 'SerialiseCompactHeader'); the tag and
+// body which follow it are serialised as usual, and are parsed in place whichever it is.
+//
+// The full header, and then the body, are only parsed if asked for (by a node handling the
+// message rather than just forwarding it), and the body at most once.
+class MessageView {
+ public:
+  // Throws 'CommonErrors::parsing_error' if 'message' doesn't start with a valid header and tag.
+  explicit MessageView(SharedMessage message);
+
+  MessageView(const MessageView&) = delete;
+  MessageView& operator=(const MessageView&) = delete;
+
+  const SharedMessage& Serialised() const { return message_; }
+  const routing::Destination& Destination() const { return destination_; }
+  const NodeAddress& FromNode() const { return from_node_; }
+  routing::MessageId MessageId() const { return message_id_; }
+  MessageTypeTag Tag() const { return tag_; }
+  bool RelayedMessage() const { return static_cast<bool>(reply_to_address_); }
+  const boost::optional<routing::ReplyToAddress>& ReplyToAddress() const {
+    return reply_to_address_;
+  }
+  FilterType FilterValue() const { return std::make_pair(from_node_, message_id_); }
+
+  // Parses the full header on the first call, throwing if it fails to parse or disagrees with the
+  // fields already read.
+  MessageHeader& Header();
+
+  // Parses the body as a 'Body'.  This can only be done once, as the body is moved out rather than
+  // copied; further calls throw 'CommonErrors::invalid_argument'.
+  template <typename Body>
+  Body ParseBody();
+
+ private:
+  SharedMessage message_;
+  routing::Destination destination_;
+  NodeAddress from_node_;
+  boost::optional<routing::ReplyToAddress> reply_to_address_;
+  routing::MessageId message_id_;
+  MessageTypeTag tag_;
+  // The compact header's size, or zero if the header is cereal-encoded.
+  std::size_t compact_header_size_;
+  std::unique_ptr<InputVectorStream> stream_;
+  boost::optional<MessageHeader> header_;
+  bool body_parsed_;
+};
+
+template <typename Body>
+Body MessageView::ParseBody() {
+  Header();
+  if (body_parsed_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  body_parsed_ = true;
+  return Parse<Body>(*stream_);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_VIEW_H_
@@ -0,0 +1,98 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MPSC_QUEUE_H_
+#define MAIDSAFE_ROUTING_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+// An unbounded lock-free queue for many producers and a single consumer.  'Push' is wait-free: a
+// producer swaps its node in as the new head and then links its predecessor to it.  Until that
+// link is made the consumer can't see past the predecessor, so 'Pop' may briefly report the queue
+// as empty while a 'Push' is in progress; the producer can rely on its value being visible to any
+// 'Pop' which starts after its 'Push' returns.
+//
+// 'Push' may be called from any thread.  'Pop' and the destructor must only be called from one
+// thread at a time.  'T' must be default constructible.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(new Node), tail_(head_.load(std::memory_order_relaxed)) {}
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue(MpscQueue&&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+  MpscQueue& operator=(MpscQueue&&) = delete;
+  ~MpscQueue();
+
+  void Push(T value);
+  // Moves the oldest value into 'value' and returns true, or returns false if there is none.
+  bool Pop(T& value);
+
+ private:
+  struct Node {
+    Node() : next(nullptr), value() {}
+    explicit Node(T value_in) : next(nullptr), value(std::move(value_in)) {}
+    std::atomic<Node*> next;
+    T value;
+  };
+
+  // The most recently pushed node; producers swap themselves in here.
+  std::atomic<Node*> head_;
+  // A node whose value has already been popped (or the initial dummy); the consumer's next value
+  // is in its successor.
+  Node* tail_;
+};
+
+template <typename T>
+MpscQueue<T>::~MpscQueue() {
+  while (tail_) {
+    Node* next(tail_->next.load(std::memory_order_relaxed));
+    delete tail_;
+    tail_ = next;
+  }
+}
+
+template <typename T>
+void MpscQueue<T>::Push(T value) {
+  Node* node(new Node(std::move(value)));
+  Node* previous(head_.exchange(node, std::memory_order_acq_rel));
+  previous->next.store(node, std::memory_order_release);
+}
+
+template <typename T>
+bool MpscQueue<T>::Pop(T& value) {
+  Node* next(tail_->next.load(std::memory_order_acquire));
+  if (!next)
+    return false;
+  value = std::move(next->value);
+  next->value = T();
+  delete tail_;
+  tail_ = next;
+  return true;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MPSC_QUEUE_H_
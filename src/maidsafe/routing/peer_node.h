@@ -19,12 +19,29 @@
 #ifndef MAIDSAFE_ROUTING_PEER_NODE_H_
 #define MAIDSAFE_ROUTING_PEER_NODE_H_
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/steady_timer.hpp"
+#include "boost/optional.hpp"
 
 #include "maidsafe/common/convert.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/utils.h"
 #include "maidsafe/crux/socket.hpp"
 #include "maidsafe/passport/types.h"
 
+#include "maidsafe/routing/batch_frame.h"
+#include "maidsafe/routing/buffer_pool.h"
+#include "maidsafe/routing/endpoint_pair.h"
+#include "maidsafe/routing/io_shards.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/types.h"
 
@@ -32,78 +49,176 @@ namespace maidsafe {
 
 namespace routing {
 
+// What becomes of a message sent to a peer whose send queue is at its high-water mark.
+enum class SendPolicy {
+  // The message is refused: its handler is invoked with 'no_buffer_space'.
+  reject,
+  // The oldest queued message which was itself sent with 'drop_oldest' is discarded (its handler
+  // invoked with 'operation_aborted') to make room.  If there is none, the message is refused.
+  drop_oldest
+};
+
+// A snapshot of a peer's send queue.
+struct SendQueueStats {
+  // The messages queued, including any being sent, and their total size.
+  size_t depth;
+  size_t bytes;
+  uint64_t sent;
+  uint64_t rejected;
+  uint64_t dropped;
+  // The sends made on the socket.  With batching enabled this is less than 'sent'.
+  uint64_t transmissions;
+  // The time from 'Send' until a message was handed to the socket: the total over and the longest
+  // of all the messages sent so far.
+  std::chrono::steady_clock::duration total_time_in_queue;
+  std::chrono::steady_clock::duration max_time_in_queue;
+  // How long the message at the front of the queue has been waiting, or zero if it's empty.  A
+  // peer which is slow to accept data shows up here before its queue fills.
+  std::chrono::steady_clock::duration oldest_time_in_queue;
+};
+
+// Opt-in coalescing of small messages: consecutive queued messages each no bigger than
+// 'max_message_size' are sent together as one batch frame (see 'MakeBatchFrame') of at most
+// 'max_frame_size' bytes.  Messages queue up behind a send in progress anyway, and are sent as
+// soon as it completes; if none is in progress, a small message waits up to 'flush_window' for
+// others to join it (or until the frame is full) before being sent.
+struct BatchingOptions {
+  size_t max_message_size;
+  size_t max_frame_size;
+  std::chrono::steady_clock::duration flush_window;
+};
+
+// A connected peer.  Messages are sent in the order given, one send at a time: each waits in the
+// peer's send queue until the previous send has been accepted by the socket.  The queue is bounded
+// by a high-water mark, at which messages are refused or displace older ones according to their
+// 'SendPolicy'.  With batching enabled, a send may carry several small messages.
+//
+// The peer is owned and used on one thread (the control shard), but its socket may belong to
+// another shard's io_service (see 'IoShards').  In that case sends and receives are started by
+// posting to the socket's shard, and their handlers are posted back to the control shard, so the
+// handlers are always invoked on the owning thread.
 class PeerNode {
  public:
   PeerNode(const PeerNode&) = delete;
   PeerNode& operator=(const PeerNode&) = delete;
 
-  PeerNode(PeerNode&& other)
-      : node_info_(std::move(other.node_info_)),
-        receive_buffer_(std::move(other.receive_buffer_)),
-        socket_(std::move(other.socket_)),
-        destroy_indicator_(std::move(other.destroy_indicator_)) {}
-
-  PeerNode& operator=(PeerNode&& other) {
-    node_info_ = std::move(other.node_info_);
-    receive_buffer_ = std::move(other.receive_buffer_);
-    socket_ = std::move(other.socket_);
-    destroy_indicator_ = std::move(other.destroy_indicator_);
-    return *this;
-  }
+  // Not movable, since pending handlers hold 'this' and check it's alive via 'DestroyGuard()'.
+  PeerNode(PeerNode&&) = delete;
+  PeerNode& operator=(PeerNode&&) = delete;
+
+  PeerNode(NodeInfo node_info, std::shared_ptr<crux::socket> socket,
+           EndpointPair endpoint_pair = EndpointPair())
+      : PeerNode(std::move(node_info), std::move(socket), std::move(endpoint_pair), nullptr, 0) {}
 
-  PeerNode(NodeInfo node_info, std::shared_ptr<crux::socket> socket)
+  // As above, for a socket on the given shard of 'shards'.
+  PeerNode(NodeInfo node_info, std::shared_ptr<crux::socket> socket, EndpointPair endpoint_pair,
+           IoShards* shards, size_t shard)
       : node_info_(std::move(node_info)),
-        receive_buffer_(std::make_shared<SerialisedMessage>(MaxMessageSize())),
+        endpoint_pair_(std::move(endpoint_pair)),
+        last_seen_(std::chrono::system_clock::now()),
         socket_(std::move(socket)),
+        shards_(shards),
+        shard_(shard),
+        send_queue_(),
+        in_flight_(0),
+        send_queue_high_water_mark_(DefaultSendQueueHighWaterMark()),
+        send_queue_stats_(),
+        batching_(),
+        flush_timer_(),
+        flush_waiting_(false),
+        flush_generation_(0),
+        flush_due_(false),
         destroy_indicator_(new boost::none_t) {}
 
-  template <typename Message, typename Handler>
-  void Send(Message msg, const Handler& handler) {
-    auto msg_ptr = std::make_shared<Message>(std::move(msg));
-    auto guard = DestroyGuard();
+  ~PeerNode() { ReleaseSocket(); }
 
-    socket_->async_send(boost::asio::buffer(*msg_ptr),
-                        [this, msg_ptr, handler, guard](boost::system::error_code error, size_t) {
-      if (!guard.lock()) {
-        // This object was destroyed.
-        return handler(asio::error::operation_aborted);
-      }
+  // The message's buffers are shared rather than copied, so the same buffers can be sent to
+  // several peers, and are handed to the socket as they are rather than being joined first.  As for
+  // a message sent, the handler of a message refused or dropped is posted to the owning thread
+  // rather than invoked from within 'Send'.  Messages still queued when the peer is destroyed are
+  // discarded without invoking their handlers.
+  template <typename Handler /* void(asio::error_code) */>
+  void Send(SharedBuffers msg, SendPolicy policy, const Handler& handler);
 
-      if (error) {
-        // TODO(team) - drop connection
-        node_info_.connected = false;
-      }
+  template <typename Handler>
+  void Send(SharedBuffers msg, const Handler& handler) {
+    Send(std::move(msg), SendPolicy::reject, handler);
+  }
 
-      handler(convert::ToStd(error));
-    });
+  template <typename Handler>
+  void Send(SharedMessage msg, SendPolicy policy, const Handler& handler) {
+    Send(SharedBuffers(1, std::move(msg)), policy, handler);
+  }
+
+  template <typename Handler>
+  void Send(SharedMessage msg, const Handler& handler) {
+    Send(std::move(msg), SendPolicy::reject, handler);
   }
 
   template <typename Handler>
+  void Send(SerialisedMessage msg, const Handler& handler) {
+    Send(MakeSharedMessage(std::move(msg)), handler);
+  }
+
+  // The number of messages (including any being sent) at which the send queue is full.
+  size_t SendQueueHighWaterMark() const { return send_queue_high_water_mark_; }
+  void SetSendQueueHighWaterMark(size_t high_water_mark) {
+    send_queue_high_water_mark_ = std::max(high_water_mark, size_t{1});
+  }
+  static size_t DefaultSendQueueHighWaterMark() { return 128; }
+
+  SendQueueStats GetSendQueueStats() const;
+
+  // Batching is off by default, and must only be enabled if the peer understands batch frames.
+  void EnableBatching(BatchingOptions options);
+  void DisableBatching();
+  static BatchingOptions DefaultBatchingOptions() {
+    return BatchingOptions{1024, 8192, std::chrono::milliseconds(2)};
+  }
+
+  // The handler is given only the bytes actually received, as a buffer it owns.  The receive
+  // buffer itself is borrowed from the shared pool for each receive, and returned to it as soon as
+  // the bytes are copied out.  The socket needs room for a whole message up front, so the buffer is
+  // always 'MaxMessageSize()' and is held for as long as the receive is pending; a peer which is
+  // always receiving therefore holds one even while idle.  The pool saves the allocation per
+  // message, not the memory.
+  template <typename Handler /* void(asio::error_code, SerialisedMessage) */>
   void Receive(const Handler& handler) {
     auto guard = DestroyGuard();
+    // Shared to make sure the buffer is valid even if this object is destroyed.
+    auto buffer(std::make_shared<BufferPool::Buffer>(SharedBufferPool().Borrow(MaxMessageSize())));
 
-    // Make a shared copy to make sure the buffer is valid
-    // even if this object is destroyed.
-    auto buffer = receive_buffer_;
+    if (OnOtherShard())
+      return ReceiveOnShard(std::move(buffer), handler);
+
+    socket_->async_receive(boost::asio::buffer(buffer->data(), buffer->size()),
+                           [this, guard, buffer, handler](boost::system::error_code error,
+                                                          size_t size) {
+      assert(error || size <= buffer->size());
+      SerialisedMessage bytes(buffer->data(), buffer->data() + (error ? 0 : size));
+      buffer->Release();
 
-    assert(buffer);
-    socket_->async_receive(boost::asio::buffer(*buffer),
-                           [guard, buffer, handler](boost::system::error_code error, size_t) {
       if (!guard.lock()) {
         // This object was destroyed.
-        return handler(asio::error::operation_aborted, *buffer);
+        return handler(asio::error::operation_aborted, SerialisedMessage());
       }
 
       if (error) {
-        return handler(convert::ToStd(error), *buffer);
+        return handler(convert::ToStd(error), SerialisedMessage());
       }
 
-      handler(convert::ToStd(error), *buffer);
+      last_seen_ = std::chrono::system_clock::now();
+      handler(convert::ToStd(error), std::move(bytes));
     });
   }
 
   const Address& id() const { return node_info_.id; }
   const NodeInfo& node_info() const { return node_info_; }
+  // The endpoints this peer was reached on, and when we last received from it.
+  const EndpointPair& endpoint_pair() const { return endpoint_pair_; }
+  std::chrono::system_clock::time_point last_seen() const { return last_seen_; }
+  // The shard whose io_service the socket belongs to (0 if unsharded).
+  size_t shard() const { return shard_; }
 
   std::weak_ptr<boost::none_t> DestroyGuard() { return destroy_indicator_; }
 
@@ -111,12 +226,284 @@ class PeerNode {
   static size_t MaxMessageSize() { return 1048576; }
 
  private:
+  struct QueuedSend {
+    SharedBuffers message;
+    std::size_t size;
+    SendPolicy policy;
+    std::function<void(asio::error_code)> handler;
+    std::chrono::steady_clock::time_point queued;
+  };
+
+  bool OnOtherShard() const { return shards_ && shard_ != 0; }
+
+  // Hands the message at the front of the queue (or a batch of messages) to the socket, unless
+  // another send is in progress or a small message is waiting for others to batch with.
+  void SendNext();
+  // The number of messages at the front of the queue which can be batched, and whether the batch
+  // is complete (no further message could be added to it).
+  std::pair<size_t, bool> Batchable() const;
+  boost::asio::io_service& OwnerService();
+  // Sends 'msg' on the socket as one message, invoking 'handler' once the socket has accepted it.
+  template <typename Handler>
+  void Transmit(SharedBuffers msg, const Handler& handler);
+  template <typename Handler>
+  void TransmitOnShard(SharedBuffers msg, const Handler& handler);
+  static std::vector<boost::asio::const_buffer> SocketBuffers(const SharedBuffers& msg);
+  template <typename Handler>
+  void ReceiveOnShard(std::shared_ptr<BufferPool::Buffer> buffer, const Handler& handler);
+
+  void ReleaseSocket() {
+    if (OnOtherShard())
+      (*shards_)[shard_].Release(std::move(socket_));
+  }
+
   NodeInfo node_info_;
-  std::shared_ptr<SerialisedMessage> receive_buffer_;
+  EndpointPair endpoint_pair_;
+  std::chrono::system_clock::time_point last_seen_;
   std::shared_ptr<crux::socket> socket_;  // TODO(Team): ditch shared_ptr
+  IoShards* shards_;
+  size_t shard_;
+  // The first 'in_flight_' messages are those being sent.
+  std::deque<QueuedSend> send_queue_;
+  size_t in_flight_;
+  size_t send_queue_high_water_mark_;
+  SendQueueStats send_queue_stats_;
+  boost::optional<BatchingOptions> batching_;
+  std::unique_ptr<boost::asio::steady_timer> flush_timer_;
+  bool flush_waiting_;
+  // Bumped whenever the flush timer is set or cancelled, so a wait which had already completed
+  // when the timer was cancelled is ignored.
+  size_t flush_generation_;
+  // Set once a small message has waited the flush window, so must be sent as soon as possible.
+  bool flush_due_;
   std::shared_ptr<boost::none_t> destroy_indicator_;
 };
 
+template <typename Handler>
+void PeerNode::Send(SharedBuffers msg, SendPolicy policy, const Handler& handler) {
+  assert(std::all_of(msg.begin(), msg.end(),
+                     [](const SharedMessage& buffer) { return buffer != nullptr; }));
+  if (send_queue_.size() >= send_queue_high_water_mark_) {
+    auto droppable(send_queue_.end());
+    if (policy == SendPolicy::drop_oldest) {
+      droppable = std::find_if(send_queue_.begin() + in_flight_, send_queue_.end(),
+                               [](const QueuedSend& queued) {
+                                 return queued.policy == SendPolicy::drop_oldest;
+                               });
+    }
+    if (droppable == send_queue_.end()) {
+      if (send_queue_stats_.rejected++ == 0) {
+        LOG(kWarning) << "Send queue to " << HexSubstr(id().string())
+                      << " is full; refusing messages";
+      }
+      OwnerService().post([handler]() { handler(asio::error::no_buffer_space); });
+      return;
+    }
+    auto dropped_handler(std::move(droppable->handler));
+    send_queue_stats_.bytes -= droppable->size;
+    send_queue_.erase(droppable);
+    ++send_queue_stats_.dropped;
+    OwnerService().post([dropped_handler]() { dropped_handler(asio::error::operation_aborted); });
+  }
+
+  const auto size(BufferSize(msg));
+  send_queue_stats_.bytes += size;
+  send_queue_.push_back(
+      QueuedSend{std::move(msg), size, policy, handler, std::chrono::steady_clock::now()});
+  SendNext();
+}
+
+inline void PeerNode::SendNext() {
+  if (in_flight_ != 0 || send_queue_.empty())
+    return;
+
+  size_t count(1);
+  if (batching_) {
+    bool complete(false);
+    std::tie(count, complete) = Batchable();
+    if (count != 0 && !complete && !flush_due_ &&
+        batching_->flush_window > std::chrono::steady_clock::duration::zero()) {
+      // Wait for more messages to batch with, unless already waiting.
+      if (flush_waiting_)
+        return;
+      flush_waiting_ = true;
+      const auto generation(++flush_generation_);
+      auto guard = DestroyGuard();
+      flush_timer_->expires_from_now(batching_->flush_window);
+      flush_timer_->async_wait([this, guard, generation](const boost::system::error_code& error) {
+        if (!guard.lock() || error == boost::asio::error::operation_aborted ||
+            generation != flush_generation_) {
+          return;
+        }
+        flush_waiting_ = false;
+        flush_due_ = true;
+        SendNext();
+      });
+      return;
+    }
+    count = std::max(count, size_t{1});
+  }
+  flush_due_ = false;
+  if (flush_waiting_) {
+    flush_waiting_ = false;
+    ++flush_generation_;
+    flush_timer_->cancel();
+  }
+
+  in_flight_ = count;
+  const auto now(std::chrono::steady_clock::now());
+  for (size_t i(0); i < count; ++i) {
+    auto waited(now - send_queue_[i].queued);
+    send_queue_stats_.total_time_in_queue += waited;
+    send_queue_stats_.max_time_in_queue = std::max(send_queue_stats_.max_time_in_queue, waited);
+  }
+
+  SharedBuffers message(send_queue_.front().message);
+  if (count > 1) {
+    std::vector<SharedBuffers> batch;
+    batch.reserve(count);
+    for (size_t i(0); i < count; ++i)
+      batch.push_back(send_queue_[i].message);
+    message.assign(1, MakeSharedMessage(MakeBatchFrame(batch)));
+  }
+  ++send_queue_stats_.transmissions;
+
+  auto guard = DestroyGuard();
+  Transmit(message, [this, guard](asio::error_code error) {
+    if (!guard.lock())
+      return;
+    std::vector<std::function<void(asio::error_code)>> handlers;
+    handlers.reserve(in_flight_);
+    for (; in_flight_ != 0; --in_flight_) {
+      auto& sent(send_queue_.front());
+      send_queue_stats_.bytes -= sent.size;
+      ++send_queue_stats_.sent;
+      handlers.push_back(std::move(sent.handler));
+      send_queue_.pop_front();
+    }
+    // Whatever queued up behind this send has waited long enough, so goes out straight away.
+    flush_due_ = !send_queue_.empty();
+    for (const auto& handler : handlers) {
+      handler(error);
+      if (!guard.lock())
+        return;
+    }
+    SendNext();
+  });
+}
+
+inline std::pair<size_t, bool> PeerNode::Batchable() const {
+  size_t count(0), frame_size(BatchFrameOverhead(0));
+  for (const auto& queued : send_queue_) {
+    const auto size(queued.size);
+    if (size > batching_->max_message_size || count == MaxBatchFrameMessages() ||
+        frame_size + BatchFrameOverhead(1) - BatchFrameOverhead(0) + size >
+            batching_->max_frame_size) {
+      return std::make_pair(count, true);
+    }
+    frame_size += BatchFrameOverhead(1) - BatchFrameOverhead(0) + size;
+    ++count;
+  }
+  return std::make_pair(count, false);
+}
+
+inline void PeerNode::EnableBatching(BatchingOptions options) {
+  batching_ = options;
+  if (!flush_timer_)
+    flush_timer_ = maidsafe::make_unique<boost::asio::steady_timer>(OwnerService());
+}
+
+inline void PeerNode::DisableBatching() {
+  batching_ = boost::none;
+  SendNext();
+}
+
+inline boost::asio::io_service& PeerNode::OwnerService() {
+  return shards_ ? shards_->Control().service() : socket_->get_io_service();
+}
+
+inline SendQueueStats PeerNode::GetSendQueueStats() const {
+  auto stats(send_queue_stats_);
+  stats.depth = send_queue_.size();
+  if (!send_queue_.empty())
+    stats.oldest_time_in_queue = std::chrono::steady_clock::now() - send_queue_.front().queued;
+  return stats;
+}
+
+template <typename Handler>
+void PeerNode::Transmit(SharedBuffers msg, const Handler& handler) {
+  if (OnOtherShard())
+    return TransmitOnShard(std::move(msg), handler);
+  auto guard = DestroyGuard();
+
+  socket_->async_send(SocketBuffers(msg),
+                      [this, msg, handler, guard](boost::system::error_code error, size_t) {
+    if (!guard.lock()) {
+      // This object was destroyed.
+      return handler(asio::error::operation_aborted);
+    }
+
+    if (error) {
+      // TODO(team) - drop connection
+      node_info_.connected = false;
+    }
+
+    handler(convert::ToStd(error));
+  });
+}
+
+template <typename Handler>
+void PeerNode::TransmitOnShard(SharedBuffers msg, const Handler& handler) {
+  auto guard = DestroyGuard();
+  auto socket = socket_;
+  auto& control = shards_->Control();
+  (*shards_)[shard_].Post([=, &control]() {
+    socket->async_send(SocketBuffers(msg),
+                       [=, &control](boost::system::error_code error, size_t) {
+      static_cast<void>(msg);
+      control.Post([=]() {
+        if (!guard.lock())
+          return handler(asio::error::operation_aborted);
+        if (error)
+          node_info_.connected = false;
+        handler(convert::ToStd(error));
+      });
+    });
+  });
+}
+
+inline std::vector<boost::asio::const_buffer> PeerNode::SocketBuffers(const SharedBuffers& msg) {
+  std::vector<boost::asio::const_buffer> buffers;
+  buffers.reserve(msg.size());
+  for (const auto& buffer : msg)
+    buffers.push_back(boost::asio::buffer(*buffer));
+  return buffers;
+}
+
+template <typename Handler>
+void PeerNode::ReceiveOnShard(std::shared_ptr<BufferPool::Buffer> buffer, const Handler& handler) {
+  auto guard = DestroyGuard();
+  auto socket = socket_;
+  auto& control = shards_->Control();
+  (*shards_)[shard_].Post([=, &control]() {
+    socket->async_receive(boost::asio::buffer(buffer->data(), buffer->size()),
+                          [=, &control](boost::system::error_code error, size_t size) {
+      // Copy out here, on the socket's thread, so the buffer goes straight back to the pool.
+      auto bytes(std::make_shared<SerialisedMessage>(buffer->data(),
+                                                     buffer->data() + (error ? 0 : size)));
+      buffer->Release();
+      control.Post([=]() {
+        if (!guard.lock())
+          return handler(asio::error::operation_aborted, SerialisedMessage());
+        if (error)
+          return handler(convert::ToStd(error), SerialisedMessage());
+        last_seen_ = std::chrono::system_clock::now();
+        handler(convert::ToStd(error), std::move(*bytes));
+      });
+    });
+  });
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
@@ -0,0 +1,216 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/peer_snapshot.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const std::array<byte, 8> kMagic = {{'M', 'S', 'P', 'E', 'E', 'R', 'S', 0}};
+const uint32_t kVersion = 1;
+
+// Header: magic, version, record size, record count, reserved.
+const std::size_t kHeaderSize = 24;
+
+// Record: ID, local endpoint, external endpoint, last-seen time (milliseconds since the epoch),
+// fob offset (from the start of the file), fob size, reserved.  Each endpoint is an address family
+// (4 or 6), a pad byte, the port, then 16 bytes of address of which a v4 address uses the first 4.
+const std::size_t kEndpointSize = 20;
+const std::size_t kIdOffset = 0;
+const std::size_t kLocalOffset = kIdOffset + identity_size;
+const std::size_t kExternalOffset = kLocalOffset + kEndpointSize;
+const std::size_t kLastSeenOffset = kExternalOffset + kEndpointSize;
+const std::size_t kFobOffsetOffset = kLastSeenOffset + 8;
+const std::size_t kFobSizeOffset = kFobOffsetOffset + 4;
+const std::size_t kRecordSize = 128;
+static_assert(kFobSizeOffset + 4 <= kRecordSize, "Snapshot record fields overrun the record.");
+
+template <typename Integer>
+void Store(Integer value, byte* out) {
+  for (std::size_t i(0); i < sizeof(Integer); ++i)
+    out[i] = static_cast<byte>(static_cast<uint64_t>(value) >> (8 * i));
+}
+
+template <typename Integer>
+Integer Load(const byte* in) {
+  uint64_t value(0);
+  for (std::size_t i(0); i < sizeof(Integer); ++i)
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  return static_cast<Integer>(value);
+}
+
+void StoreEndpoint(const EndpointPair::Endpoint& endpoint, byte* out) {
+  const auto address(endpoint.address());
+  if (address.is_v4()) {
+    out[0] = 4;
+    const auto bytes(address.to_v4().to_bytes());
+    std::copy(std::begin(bytes), std::end(bytes), out + 4);
+  } else {
+    out[0] = 6;
+    const auto bytes(address.to_v6().to_bytes());
+    std::copy(std::begin(bytes), std::end(bytes), out + 4);
+  }
+  Store(endpoint.port(), out + 2);
+}
+
+EndpointPair::Endpoint LoadEndpoint(const byte* in) {
+  const auto port(Load<uint16_t>(in + 2));
+  if (in[0] == 4) {
+    asio::ip::address_v4::bytes_type bytes;
+    std::copy(in + 4, in + 4 + bytes.size(), std::begin(bytes));
+    return EndpointPair::Endpoint(asio::ip::address_v4(bytes), port);
+  }
+  if (in[0] == 6) {
+    asio::ip::address_v6::bytes_type bytes;
+    std::copy(in + 4, in + 4 + bytes.size(), std::begin(bytes));
+    return EndpointPair::Endpoint(asio::ip::address_v6(bytes), port);
+  }
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+}  // unnamed namespace
+
+SerialisedMessage SerialisePeerSnapshot(const PeerSnapshot& peers) {
+  std::vector<SerialisedMessage> fobs;
+  fobs.reserve(peers.size());
+  std::size_t size(kHeaderSize + peers.size() * kRecordSize);
+  for (const auto& peer : peers) {
+    fobs.push_back(Serialise(peer.node_info.dht_fob));
+    size += fobs.back().size();
+  }
+
+  SerialisedMessage result(size, 0);
+  auto header(result.data());
+  std::copy(std::begin(kMagic), std::end(kMagic), header);
+  Store(kVersion, header + 8);
+  Store(static_cast<uint32_t>(kRecordSize), header + 12);
+  Store(static_cast<uint32_t>(peers.size()), header + 16);
+
+  auto fob_offset(kHeaderSize + peers.size() * kRecordSize);
+  for (std::size_t i(0); i < peers.size(); ++i) {
+    auto record(result.data() + kHeaderSize + i * kRecordSize);
+    const auto& id(peers[i].node_info.id.string());
+    std::copy(std::begin(id), std::end(id), record + kIdOffset);
+    StoreEndpoint(peers[i].endpoint_pair.local, record + kLocalOffset);
+    StoreEndpoint(peers[i].endpoint_pair.external, record + kExternalOffset);
+    Store(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   peers[i].last_seen.time_since_epoch()).count()),
+          record + kLastSeenOffset);
+    Store(static_cast<uint32_t>(fob_offset), record + kFobOffsetOffset);
+    Store(static_cast<uint32_t>(fobs[i].size()), record + kFobSizeOffset);
+    std::copy(std::begin(fobs[i]), std::end(fobs[i]), result.data() + fob_offset);
+    fob_offset += fobs[i].size();
+  }
+  return result;
+}
+
+PeerSnapshot ParsePeerSnapshot(const byte* data, std::size_t size) {
+  if (size < kHeaderSize || !std::equal(std::begin(kMagic), std::end(kMagic), data) ||
+      Load<uint32_t>(data + 8) != kVersion) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  // A later version may lengthen the records, but may only append fields to them.
+  const std::size_t record_size(Load<uint32_t>(data + 12));
+  const std::size_t count(Load<uint32_t>(data + 16));
+  if (record_size < kRecordSize || count > (size - kHeaderSize) / record_size)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+
+  const std::size_t fobs_begin(kHeaderSize + count * record_size);
+  PeerSnapshot peers;
+  peers.reserve(count);
+  for (std::size_t i(0); i < count; ++i) {
+    const auto record(data + kHeaderSize + i * record_size);
+    const std::size_t fob_offset(Load<uint32_t>(record + kFobOffsetOffset));
+    const std::size_t fob_size(Load<uint32_t>(record + kFobSizeOffset));
+    if (fob_offset < fobs_begin || fob_offset > size || fob_size > size - fob_offset)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+
+    Address id(std::string(record + kIdOffset, record + kIdOffset + identity_size));
+    auto fob(Parse<passport::PublicPmid>(
+        SerialisedMessage(data + fob_offset, data + fob_offset + fob_size)));
+    if (Address(fob.Name()) != id)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+
+    PeerSnapshotEntry peer{
+        NodeInfo(std::move(id), std::move(fob), false),
+        EndpointPair(LoadEndpoint(record + kLocalOffset), LoadEndpoint(record + kExternalOffset)),
+        std::chrono::system_clock::time_point(
+            std::chrono::milliseconds(Load<int64_t>(record + kLastSeenOffset)))};
+    peers.push_back(std::move(peer));
+  }
+  return peers;
+}
+
+void WritePeerSnapshot(const boost::filesystem::path& path, const PeerSnapshot& peers) {
+  const auto contents(SerialisePeerSnapshot(peers));
+  auto temp_path(path);
+  temp_path += ".new";
+  {
+    std::ofstream out(temp_path.string(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(contents.data()),
+              static_cast<std::streamsize>(contents.size()));
+    if (!out) {
+      LOG(kError) << "Failed to write peer snapshot " << temp_path;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+  }
+  boost::system::error_code error;
+  boost::filesystem::rename(temp_path, path, error);
+  if (error) {
+    LOG(kError) << "Failed to replace peer snapshot " << path << ": " << error.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+PeerSnapshot ReadPeerSnapshot(const boost::filesystem::path& path) {
+  boost::system::error_code error;
+  const auto size(boost::filesystem::file_size(path, error));
+  if (error)
+    return PeerSnapshot();
+  if (size == 0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+
+  try {
+    boost::interprocess::file_mapping file(path.string().c_str(), boost::interprocess::read_only);
+    boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+    return ParsePeerSnapshot(static_cast<const byte*>(region.get_address()), region.get_size());
+  } catch (const boost::interprocess::interprocess_exception& e) {
+    LOG(kError) << "Failed to map peer snapshot " << path << ": " << e.what();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
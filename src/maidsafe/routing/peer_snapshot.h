@@ -0,0 +1,69 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PEER_SNAPSHOT_H_
+#define MAIDSAFE_ROUTING_PEER_SNAPSHOT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/routing/endpoint_pair.h"
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A record of the peers a node was connected to, kept on disk so that after a restart the node can
+// reconnect to them directly rather than finding its close group again via the bootstrap contacts.
+//
+// The file is a fixed-size header, then one fixed-size record per peer (its ID, endpoint pair,
+// last-seen time and the offset and size of its fob), then the serialised fobs themselves.  All
+// integers are little-endian.  As the records are of equal size and hold offsets rather than
+// pointers, the file is read by mapping it into memory rather than by parsing a stream.
+struct PeerSnapshotEntry {
+  NodeInfo node_info;
+  EndpointPair endpoint_pair;
+  std::chrono::system_clock::time_point last_seen;
+};
+
+using PeerSnapshot = std::vector<PeerSnapshotEntry>;
+
+SerialisedMessage SerialisePeerSnapshot(const PeerSnapshot& peers);
+
+// Throws 'CommonErrors::parsing_error' if the bytes aren't a valid snapshot.
+PeerSnapshot ParsePeerSnapshot(const byte* data, std::size_t size);
+
+// Replaces any snapshot at 'path'.  The new one is written beside it and then renamed over it, so
+// that a crash part way through leaves the previous snapshot intact.
+void WritePeerSnapshot(const boost::filesystem::path& path, const PeerSnapshot& peers);
+
+// Returns an empty snapshot if there is no file at 'path'.
+PeerSnapshot ReadPeerSnapshot(const boost::filesystem::path& path);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PEER_SNAPSHOT_H_
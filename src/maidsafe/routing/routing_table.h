@@ -19,17 +19,28 @@
 #ifndef MAIDSAFE_ROUTING_ROUTING_TABLE_H_
 #define MAIDSAFE_ROUTING_ROUTING_TABLE_H_
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "boost/optional.hpp"
 
+#include "maidsafe/common/error.h"
 #include "maidsafe/common/rsa.h"
+#include "maidsafe/common/utils.h"
 
+#include "maidsafe/routing/endpoint_pair.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/types.h"
+#include "maidsafe/routing/xor_distance.h"
 
 namespace maidsafe {
 
@@ -42,18 +53,81 @@ struct NodeInfo;
 // having an Address or NodeInfo arg will throw if NDEBUG is defined and the passed ID is invalid.
 // These functions assert that any such ID is valid, so it should be considered a bug if any such
 // function throws.  Other than bad_allocs, there are no other exceptions thrown from this class.
-class RoutingTable {
+//
+// Functions which modify the table are serialised by a mutex and publish an immutable snapshot of
+// the table once they've finished.  'TargetNodes', 'OurCloseGroup', 'GetPublicKey' and 'Size' only
+// read the latest snapshot, so they never wait for a modifying function to complete.
+//
+// The sizes governing the table are taken from the 'NetworkParameters' policy (see
+// 'DefaultNetworkParameters'); 'RoutingTable' is the table for the stock network.
+template <typename NetworkParameters>
+class BasicRoutingTable {
+  static_assert(0 < NetworkParameters::Parallelism &&
+                    NetworkParameters::Parallelism <= NetworkParameters::GroupSize &&
+                    NetworkParameters::GroupSize < NetworkParameters::OptimalSize,
+                "NetworkParameters must have 0 < Parallelism <= GroupSize < OptimalSize.");
+  static_assert(NetworkParameters::BucketSize >= 1, "NetworkParameters must have BucketSize >= 1.");
+
+  struct Snapshot;
+
  public:
-  static size_t BucketSize() { return 1; }
-  static size_t Parallelism() { return 4; }
-  static size_t OptimalSize() { return 64; }
+  // The contacts chosen by 'TargetNodes', held as references into the table snapshot they were
+  // chosen from.  The snapshot is kept alive by this object, so the contacts remain valid however
+  // the table changes afterwards.  Filling an existing 'Targets' doesn't allocate.
+  class Targets {
+   public:
+    Targets() : snapshot_(), nodes_(), size_(0) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const NodeInfo& operator[](size_t i) const {
+      assert(i < size_);
+      return *nodes_[i];
+    }
+
+   private:
+    friend class BasicRoutingTable;
+    std::shared_ptr<const Snapshot> snapshot_;
+    std::array<const NodeInfo*, NetworkParameters::GroupSize> nodes_;
+    size_t size_;
+  };
+
+  // The net effect of 'AddNodes': the IDs of the offered contacts which are now held, the
+  // previously-held contacts which were dropped to make room for them, and our close group before
+  // and after if it changed (as '{new group, old group}').
+  struct AddNodesResult {
+    std::vector<Address> added;
+    std::vector<NodeInfo> dropped;
+    boost::optional<CloseGroupDifference> close_group_change;
+  };
+
+  // A contact offered to the table but not added, and where it can be reached.  Each bucket keeps
+  // the 'ReplacementCacheSize()' most recently offered of these, to be added to the table as soon
+  // as a contact is dropped (see 'DropNode').
+  struct Replacement {
+    NodeInfo node_info;
+    EndpointPair endpoint_pair;
+  };
+
+  // The net effect of 'DropNodes': the replacements which were added to the table in place of the
+  // dropped contacts, and our close group before and after if it changed.
+  struct DropNodesResult {
+    std::vector<Replacement> promoted;
+    boost::optional<CloseGroupDifference> close_group_change;
+  };
 
-  explicit RoutingTable(Address our_id);
-  RoutingTable(const RoutingTable&) = delete;
-  RoutingTable(RoutingTable&&) = delete;
-  RoutingTable& operator=(const RoutingTable&) = delete;
-  RoutingTable& operator=(RoutingTable&&) MAIDSAFE_NOEXCEPT = delete;
-  ~RoutingTable() = default;
+  static size_t GroupSize() { return NetworkParameters::GroupSize; }
+  static size_t BucketSize() { return NetworkParameters::BucketSize; }
+  static size_t Parallelism() { return NetworkParameters::Parallelism; }
+  static size_t OptimalSize() { return NetworkParameters::OptimalSize; }
+  static size_t ReplacementCacheSize() { return NetworkParameters::ReplacementCacheSize; }
+
+  explicit BasicRoutingTable(Address our_id);
+  BasicRoutingTable(const BasicRoutingTable&) = delete;
+  BasicRoutingTable(BasicRoutingTable&&) = delete;
+  BasicRoutingTable& operator=(const BasicRoutingTable&) = delete;
+  BasicRoutingTable& operator=(BasicRoutingTable&&) MAIDSAFE_NOEXCEPT = delete;
+  ~BasicRoutingTable() = default;
 
   // Potentially adds a contact to the routing table.  If the contact is added, the first return arg
   // is true, otherwise false.  If adding the contact caused another contact to be dropped, the
@@ -67,15 +141,30 @@ class RoutingTable {
   // 4 - if we can find a candidate for removal (a contact in a bucket with more than 'BucketSize()'
   //     contacts, which is also not within our close group), and if the new contact will fit in a
   //     bucket closer to our own bucket, then we add the new contact.
-  std::pair<bool, boost::optional<NodeInfo>> AddNode(NodeInfo their_info);
+  //
+  // A contact which passes step 1 but is not added is kept in its bucket's replacement cache along
+  // with 'their_endpoints', unless those are unset, since it then couldn't be connected to.
+  std::pair<bool, boost::optional<NodeInfo>> AddNode(NodeInfo their_info,
+                                                     EndpointPair their_endpoints = EndpointPair());
 
   // This is used to see whether to bother retrieving a contact's public key from the PKI with a
   // view to adding the contact to our table.  The checking procedure is the same as for 'AddNode'
   // above, except for the lack of a public key to check in step 1.
   bool CheckNode(const Address& their_id) const;
 
-  // This unconditionally removes the contact from the table.
-  void DropNode(const Address& node_to_drop);
+  // This unconditionally removes the contact from the table (or from the replacement caches if it's
+  // not held).  If the table then has room, the most recently offered replacement for the dropped
+  // contact's bucket (or if it has none, for the closest bucket which has) is added and returned,
+  // so that the caller can connect to it.
+  boost::optional<Replacement> DropNode(const Address& node_to_drop);
+
+  // These are equivalent to calling 'AddNode' or 'DropNode' for each element in turn, but the lock
+  // is taken and a new snapshot published only once for the whole batch.  A contact which is both
+  // added and dropped within the batch appears in neither list of the result.  All IDs are
+  // validated before the table is modified.  Contacts not added by 'AddNodes' are not cached, as
+  // it has no endpoints for them.
+  AddNodesResult AddNodes(std::vector<NodeInfo> their_infos);
+  DropNodesResult DropNodes(const std::vector<Address>& nodes_to_drop);
 
   // This returns a collection of contacts to which a message should be sent onwards.  It will
   // return all of our close group (comprising 'GroupSize' contacts) if the closest one to the
@@ -83,6 +172,9 @@ class RoutingTable {
   // to the target.
   std::vector<NodeInfo> TargetNodes(const Address& target) const;
 
+  // As above, but writes the chosen contacts to 'targets' without copying them.
+  void TargetNodes(const Address& target, Targets& targets) const;
+
   // This returns our close group, i.e. the 'GroupSize' contacts closest to our ID (or the entire
   // table if we hold less than 'GroupSize' contacts in total).
   std::vector<NodeInfo> OurCloseGroup() const;
@@ -97,32 +189,656 @@ class RoutingTable {
   int32_t BucketIndex(const Address& node_id) const;
 
  private:
+  using Node = std::shared_ptr<const NodeInfo>;
+
   class Comparison {
    public:
-    using NodesItr = std::vector<NodeInfo>::const_iterator;
-    explicit Comparison(Address our_id) : our_id_(std::move(our_id)) {}
-    bool operator()(const NodeInfo& lhs, const NodeInfo& rhs) const {
-      return CloserToTarget(lhs.id, rhs.id, our_id_);
-    }
-    bool operator()(NodesItr lhs, NodesItr rhs) const {
-      return CloserToTarget(lhs->id, rhs->id, our_id_);
+    explicit Comparison(const Address& our_id) : our_id_(ToRawAddress(our_id)) {}
+    template <typename Lhs, typename Rhs>
+    bool operator()(const Lhs& lhs, const Rhs& rhs) const {
+      return XorCloser(Bytes(lhs), Bytes(rhs), our_id_.data());
     }
 
    private:
-    const Address our_id_;
+    static const byte* Bytes(const RawAddress& id) { return id.data(); }
+    static const byte* Bytes(const Address& id) { return AddressBytes(id); }
+
+    const RawAddress our_id_;
+  };
+
+  // The hot and cold parts of a set of contacts, held as parallel arrays sorted by closeness to
+  // us: 'ids' is all that ordering and searching touch, while 'nodes' (with their fobs) is only
+  // read once a contact has been chosen.
+  struct Contacts {
+    std::vector<RawAddress> ids;
+    std::vector<Node> nodes;
+  };
+
+  // The contacts themselves are owned by 'nodes_', which is keyed by ID so that membership lookups
+  // are O(1).  Each bucket holds the contacts sharing exactly 'index' leading bits with our ID.
+  // Only non-empty buckets are held, and since a higher index means closer to us, iterating
+  // 'buckets_' from the start visits the whole table in order of closeness to us.
+  using Nodes = std::unordered_map<RawAddress, Node, RawAddressHash>;
+
+  // Each bucket's contacts are immutable once published, so a snapshot shares them with the table
+  // and with other snapshots.  The table changes a bucket in place only while no snapshot holds
+  // it; otherwise the bucket is copied first (see 'MutableBucket').
+  using Bucket = std::shared_ptr<Contacts>;
+  using Buckets = std::map<int32_t, Bucket, std::greater<int32_t>>;
+
+  // An immutable view of the table: its non-empty buckets, closest to us first, so that our close
+  // group is the first 'GroupSize' contacts visited.  Publishing one only copies the bucket
+  // pointers, and an ID is found by its bucket index and then its closeness to us.
+  struct Snapshot {
+    Snapshot() : buckets(), size(0) {}
+    std::vector<std::pair<int32_t, std::shared_ptr<const Contacts>>> buckets;
+    size_t size;
   };
-  bool HaveNode(const Address& their_id) const;
-  bool NewNodeIsBetterThanExisting(const Address& their_id,
-                                   std::vector<NodeInfo>::const_iterator removal_candidate) const;
-  void PushBackThenSort(NodeInfo their_info);
-  std::vector<NodeInfo>::const_iterator FindCandidateForRemoval() const;
+
+  // False if the contact is ourself or doesn't have a valid public key.
+  bool IsAcceptable(const NodeInfo& their_info) const;
+  // 'AddNode' for an acceptable contact, without the lock or publishing a snapshot.  Returns the
+  // added contact (or nullptr) rather than a bool.
+  std::pair<const NodeInfo*, boost::optional<NodeInfo>> DoAddNode(NodeInfo their_info,
+                                                                  EndpointPair their_endpoints);
+  std::vector<Address> CloseGroupIds() const;
+  boost::optional<CloseGroupDifference> CloseGroupChange(std::vector<Address> old_group) const;
+  bool HaveNode(const RawAddress& their_id) const;
+  int32_t BucketIndex(const RawAddress& their_id) const;
+  bool NewNodeIsBetterThanExisting(const RawAddress& their_id, int32_t removal_bucket) const;
+  const NodeInfo* InsertNode(NodeInfo their_info);
+  NodeInfo RemoveNode(RawAddress their_id);
+  // Returns the ID of the contact which follows 'id' in order of closeness to us, or nullptr if
+  // there is none.
+  const RawAddress* NextFurther(const RawAddress& id) const;
+  // Returns the index of the furthest bucket holding more than 'BucketSize()' contacts outside our
+  // close group, i.e. the bucket from which a contact can be removed, or -1 if there is none.
+  int32_t FindBucketForRemoval() const;
+  const RawAddress& FindCandidateForRemoval(int32_t removal_bucket) const;
+  // Must be called whenever a contact in the given bucket joins ('added' true) or leaves the set of
+  // contacts outside our close group.
+  void CountOutsideCloseGroup(int32_t bucket_index, bool added);
+  void CacheReplacement(int32_t bucket_index, NodeInfo their_info, EndpointPair their_endpoints);
+  void UncacheReplacement(int32_t bucket_index, const Address& their_id);
+  // Adds the most recently offered replacement for the given bucket (or failing that, the closest
+  // bucket) if there's room in the table.
+  boost::optional<Replacement> PromoteReplacement(int32_t bucket_index);
+  // Returns the given bucket (creating it if need be) for modification, first copying it if a
+  // snapshot shares it.
+  Contacts& MutableBucket(Bucket& bucket);
+  Contacts& MutableBucket(int32_t bucket_index);
+  // Must be called with 'mutex_' held after any change to the table.
+  void PublishSnapshot();
+  std::shared_ptr<const Snapshot> LoadSnapshot() const;
 
   const Address our_id_;
+  const RawAddress raw_our_id_;
   const Comparison comparison_;
   mutable std::mutex mutex_;
-  std::vector<NodeInfo> nodes_;
+  Nodes nodes_;
+  Buckets buckets_;
+  // The IDs of our close group, i.e. the 'GroupSize' contacts closest to us, sorted by closeness.
+  std::vector<RawAddress> close_group_;
+  // The number of contacts outside our close group held in each bucket, indexed by bucket index,
+  // and a bitmask (bit 'i % 32' of word 'i / 32' for bucket 'i') of the buckets where this exceeds
+  // 'BucketSize()'.
+  std::array<uint32_t, 8 * identity_size> outside_close_group_;
+  std::array<uint32_t, identity_size / 4> over_capacity_;
+  // Each bucket's replacement cache, oldest first.  These are kept for buckets which are empty too.
+  std::map<int32_t, std::deque<Replacement>> replacements_;
+  // Only accessed via the std::atomic_load/atomic_store overloads for shared_ptr.
+  std::shared_ptr<const Snapshot> snapshot_;
 };
 
+using RoutingTable = BasicRoutingTable<DefaultNetworkParameters>;
+
+namespace detail {
+
+inline void Validate(const Address& id) {
+  assert(id.IsInitialised());
+  if (!id.IsInitialised())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_identity));
+}
+
+}  // namespace detail
+
+template <typename NetworkParameters>
+BasicRoutingTable<NetworkParameters>::BasicRoutingTable(Address our_id)
+    : our_id_(std::move(our_id)),
+      raw_our_id_(ToRawAddress(our_id_)),
+      comparison_(our_id_),
+      mutex_(),
+      nodes_(),
+      buckets_(),
+      close_group_(),
+      outside_close_group_(),
+      over_capacity_(),
+      replacements_(),
+      snapshot_(std::make_shared<Snapshot>()) {
+  assert(our_id_.IsInitialised());
+  nodes_.reserve(OptimalSize() + 1);
+  close_group_.reserve(GroupSize() + 1);
+}
+
+template <typename NetworkParameters>
+std::pair<bool, boost::optional<NodeInfo>> BasicRoutingTable<NetworkParameters>::AddNode(
+    NodeInfo their_info, EndpointPair their_endpoints) {
+  detail::Validate(their_info.id);
+  if (!IsAcceptable(their_info))
+    return {false, boost::none};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto result(DoAddNode(std::move(their_info), std::move(their_endpoints)));
+  if (!result.first)
+    return {false, boost::none};
+  PublishSnapshot();
+  return {true, std::move(result.second)};
+}
+
+template <typename NetworkParameters>
+bool BasicRoutingTable<NetworkParameters>::CheckNode(const Address& their_id) const {
+  detail::Validate(their_id);
+  if (their_id == our_id_)
+    return false;
+
+  auto raw_id(ToRawAddress(their_id));
+  std::lock_guard<std::mutex> lock(mutex_);
+  // check for duplicates
+  if (HaveNode(raw_id))
+    return false;
+
+  if (nodes_.size() < OptimalSize())
+    return true;
+
+  // close node
+  if (comparison_(raw_id, *NextFurther(close_group_.back())))
+    return true;
+
+  return NewNodeIsBetterThanExisting(raw_id, FindBucketForRemoval());
+}
+
+template <typename NetworkParameters>
+boost::optional<typename BasicRoutingTable<NetworkParameters>::Replacement>
+BasicRoutingTable<NetworkParameters>::DropNode(const Address& node_to_drop) {
+  detail::Validate(node_to_drop);
+  if (node_to_drop == our_id_)
+    return boost::none;
+  auto raw_id(ToRawAddress(node_to_drop));
+  auto bucket_index(BucketIndex(raw_id));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!HaveNode(raw_id)) {
+    UncacheReplacement(bucket_index, node_to_drop);
+    return boost::none;
+  }
+  RemoveNode(raw_id);
+  auto promoted(PromoteReplacement(bucket_index));
+  PublishSnapshot();
+  return promoted;
+}
+
+template <typename NetworkParameters>
+typename BasicRoutingTable<NetworkParameters>::DropNodesResult
+BasicRoutingTable<NetworkParameters>::DropNodes(const std::vector<Address>& nodes_to_drop) {
+  for (const auto& node_to_drop : nodes_to_drop)
+    detail::Validate(node_to_drop);
+
+  DropNodesResult result;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto old_group(CloseGroupIds());
+  bool dropped(false);
+  for (const auto& node_to_drop : nodes_to_drop) {
+    auto raw_id(ToRawAddress(node_to_drop));
+    if (raw_id == raw_our_id_)
+      continue;
+    auto bucket_index(BucketIndex(raw_id));
+    if (!HaveNode(raw_id)) {
+      UncacheReplacement(bucket_index, node_to_drop);
+      continue;
+    }
+    RemoveNode(raw_id);
+    dropped = true;
+    // a replacement promoted earlier in this batch may itself be dropped
+    result.promoted.erase(std::remove_if(std::begin(result.promoted), std::end(result.promoted),
+                                         [&](const Replacement& replacement) {
+                                           return replacement.node_info.id == node_to_drop;
+                                         }),
+                          std::end(result.promoted));
+    auto promoted(PromoteReplacement(bucket_index));
+    if (promoted)
+      result.promoted.push_back(std::move(*promoted));
+  }
+  if (!dropped)
+    return result;
+  PublishSnapshot();
+  result.close_group_change = CloseGroupChange(std::move(old_group));
+  return result;
+}
+
+template <typename NetworkParameters>
+typename BasicRoutingTable<NetworkParameters>::AddNodesResult
+BasicRoutingTable<NetworkParameters>::AddNodes(std::vector<NodeInfo> their_infos) {
+  for (const auto& their_info : their_infos)
+    detail::Validate(their_info.id);
+  their_infos.erase(std::remove_if(std::begin(their_infos), std::end(their_infos),
+                                   [&](const NodeInfo& their_info) {
+                                     return !IsAcceptable(their_info);
+                                   }),
+                    std::end(their_infos));
+
+  AddNodesResult result;
+  std::unordered_map<Address, NodeInfo, AddressHash> dropped;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto old_group(CloseGroupIds());
+  for (auto& their_info : their_infos) {
+    auto outcome(DoAddNode(std::move(their_info), EndpointPair()));
+    if (outcome.first)
+      result.added.push_back(outcome.first->id);
+    if (outcome.second) {
+      Address dropped_id(outcome.second->id);
+      dropped.emplace(std::move(dropped_id), std::move(*outcome.second));
+    }
+  }
+  if (result.added.empty())
+    return result;
+
+  // anything added and then dropped again by this batch is omitted from both lists
+  result.added.erase(std::remove_if(std::begin(result.added), std::end(result.added),
+                                    [&](const Address& id) { return dropped.erase(id) != 0; }),
+                     std::end(result.added));
+  result.dropped.reserve(dropped.size());
+  for (auto& node : dropped)
+    result.dropped.push_back(std::move(node.second));
+  result.close_group_change = CloseGroupChange(std::move(old_group));
+  PublishSnapshot();
+  return result;
+}
+
+template <typename NetworkParameters>
+std::vector<NodeInfo> BasicRoutingTable<NetworkParameters>::TargetNodes(
+    const Address& target) const {
+  Targets targets;
+  TargetNodes(target, targets);
+  std::vector<NodeInfo> result;
+  result.reserve(targets.size());
+  for (size_t i(0); i < targets.size(); ++i)
+    result.push_back(targets[i]);
+  return result;
+}
+
+template <typename NetworkParameters>
+void BasicRoutingTable<NetworkParameters>::TargetNodes(const Address& target,
+                                                       Targets& targets) const {
+  detail::Validate(target);
+  targets.snapshot_ = LoadSnapshot();
+  targets.size_ = 0;
+  const auto& snapshot(*targets.snapshot_);
+  if (snapshot.size == 0)
+    return;
+
+  // select the 'parallelism' contacts closest to target, held in order of closeness to target
+  // along with their rank in order of closeness to us
+  struct Candidate {
+    const RawAddress* id;
+    const NodeInfo* node;
+    size_t rank;
+  };
+  std::array<Candidate, NetworkParameters::Parallelism> closest;
+  auto parallelism = std::min(Parallelism(), snapshot.size);
+  const byte* target_bytes(AddressBytes(target));
+  size_t count(0), rank(0);
+  for (const auto& bucket : snapshot.buckets) {
+    const auto& ids(bucket.second->ids);
+    for (size_t i(0); i < ids.size(); ++i, ++rank) {
+      auto closer([&](const Candidate& candidate) {
+        return XorCloser(ids[i].data(), candidate.id->data(), target_bytes);
+      });
+      if (count == parallelism && !closer(closest[count - 1]))
+        continue;
+      auto position(count < parallelism ? count++ : count - 1);
+      for (; position > 0 && closer(closest[position - 1]); --position)
+        closest[position] = closest[position - 1];
+      closest[position] = Candidate{&ids[i], bucket.second->nodes[i].get(), rank};
+    }
+  }
+
+  // if the closest to target is within our close group, just return the close group
+  if (closest.front().rank < GroupSize()) {
+    auto group_size(std::min(GroupSize(), snapshot.size));
+    for (const auto& bucket : snapshot.buckets) {
+      for (const auto& node : bucket.second->nodes) {
+        if (targets.size_ == group_size)
+          return;
+        targets.nodes_[targets.size_++] = node.get();
+      }
+    }
+  } else {  // return the 'parallelism' closest-to-target contacts
+    for (size_t i(0); i < parallelism; ++i)
+      targets.nodes_[i] = closest[i].node;
+    targets.size_ = parallelism;
+  }
+}
+
+template <typename NetworkParameters>
+std::vector<NodeInfo> BasicRoutingTable<NetworkParameters>::OurCloseGroup() const {
+  auto snapshot(LoadSnapshot());
+  auto group_size(std::min(GroupSize(), snapshot->size));
+  std::vector<NodeInfo> result;
+  result.reserve(group_size);
+  for (const auto& bucket : snapshot->buckets) {
+    for (const auto& node : bucket.second->nodes) {
+      if (result.size() == group_size)
+        return result;
+      result.push_back(*node);
+    }
+  }
+  return result;
+}
+
+template <typename NetworkParameters>
+boost::optional<asymm::PublicKey> BasicRoutingTable<NetworkParameters>::GetPublicKey(
+    const Address& their_id) const {
+  detail::Validate(their_id);
+  if (their_id == our_id_)
+    return boost::none;
+  auto raw_id(ToRawAddress(their_id));
+  auto bucket_index(BucketIndex(raw_id));
+  auto snapshot(LoadSnapshot());
+  const auto& buckets(snapshot->buckets);
+  auto bucket_itr(std::lower_bound(
+      std::begin(buckets), std::end(buckets), bucket_index,
+      [](const std::pair<int32_t, std::shared_ptr<const Contacts>>& bucket, int32_t index) {
+        return bucket.first > index;
+      }));
+  if (bucket_itr == std::end(buckets) || bucket_itr->first != bucket_index)
+    return boost::none;
+  const auto& contacts(*bucket_itr->second);
+  auto itr(std::lower_bound(std::begin(contacts.ids), std::end(contacts.ids), raw_id, comparison_));
+  if (itr == std::end(contacts.ids) || *itr != raw_id)
+    return boost::none;
+  return contacts.nodes[itr - std::begin(contacts.ids)]->dht_fob.public_key();
+}
+
+template <typename NetworkParameters>
+size_t BasicRoutingTable<NetworkParameters>::Size() const {
+  return LoadSnapshot()->size;
+}
+
+// bucket 511 is us, 0 is furthest bucket (should fill first)
+template <typename NetworkParameters>
+int32_t BasicRoutingTable<NetworkParameters>::BucketIndex(const Address& address) const {
+  assert(address != our_id_);
+  return XorCommonLeadingBits(our_id_, address);
+}
+
+template <typename NetworkParameters>
+int32_t BasicRoutingTable<NetworkParameters>::BucketIndex(const RawAddress& their_id) const {
+  assert(their_id != raw_our_id_);
+  return XorCommonLeadingBits(raw_our_id_.data(), their_id.data());
+}
+
+template <typename NetworkParameters>
+bool BasicRoutingTable<NetworkParameters>::IsAcceptable(const NodeInfo& their_info) const {
+  return their_info.id != our_id_ && asymm::ValidateKey(their_info.dht_fob.public_key());
+}
+
+template <typename NetworkParameters>
+std::pair<const NodeInfo*, boost::optional<NodeInfo>>
+BasicRoutingTable<NetworkParameters>::DoAddNode(NodeInfo their_info, EndpointPair their_endpoints) {
+  auto their_id(ToRawAddress(their_info.id));
+  // check not duplicate
+  if (HaveNode(their_id))
+    return {nullptr, boost::none};
+
+  // routing table small, just grab this node
+  if (nodes_.size() < OptimalSize())
+    return {InsertNode(std::move(their_info)), boost::none};
+
+  // new close group member
+  if (comparison_(their_id, *NextFurther(close_group_.back()))) {
+    // first push the new node in (it's close) and then get another sacrificial node if we can
+    // this will make RT grow but only after several tens of millions of nodes
+    auto added(InsertNode(std::move(their_info)));
+    auto removal_bucket(FindBucketForRemoval());
+    if (removal_bucket < 0)
+      return {added, boost::none};
+    return {added, RemoveNode(FindCandidateForRemoval(removal_bucket))};
+  }
+
+  // is there a node we can remove
+  auto removal_bucket(FindBucketForRemoval());
+  if (NewNodeIsBetterThanExisting(their_id, removal_bucket)) {
+    auto removed(RemoveNode(FindCandidateForRemoval(removal_bucket)));
+    return {InsertNode(std::move(their_info)), std::move(removed)};
+  }
+  CacheReplacement(BucketIndex(their_id), std::move(their_info), std::move(their_endpoints));
+  return {nullptr, boost::none};
+}
+
+template <typename NetworkParameters>
+std::vector<Address> BasicRoutingTable<NetworkParameters>::CloseGroupIds() const {
+  std::vector<Address> ids;
+  ids.reserve(close_group_.size());
+  for (const auto& id : close_group_)
+    ids.push_back(nodes_.find(id)->second->id);
+  return ids;
+}
+
+template <typename NetworkParameters>
+boost::optional<CloseGroupDifference> BasicRoutingTable<NetworkParameters>::CloseGroupChange(
+    std::vector<Address> old_group) const {
+  auto new_group(CloseGroupIds());
+  if (new_group == old_group)
+    return boost::none;
+  return std::make_pair(std::move(new_group), std::move(old_group));
+}
+
+template <typename NetworkParameters>
+bool BasicRoutingTable<NetworkParameters>::HaveNode(const RawAddress& their_id) const {
+  return nodes_.find(their_id) != std::end(nodes_);
+}
+
+template <typename NetworkParameters>
+bool BasicRoutingTable<NetworkParameters>::NewNodeIsBetterThanExisting(
+    const RawAddress& their_id, int32_t removal_bucket) const {
+  return removal_bucket >= 0 && BucketIndex(their_id) > removal_bucket;
+}
+
+template <typename NetworkParameters>
+const NodeInfo* BasicRoutingTable<NetworkParameters>::InsertNode(NodeInfo their_info) {
+  auto id(ToRawAddress(their_info.id));
+  auto node(std::make_shared<const NodeInfo>(std::move(their_info)));
+  auto bucket_index(BucketIndex(id));
+  UncacheReplacement(bucket_index, node->id);
+  if (close_group_.size() < GroupSize() || comparison_(id, close_group_.back())) {
+    close_group_.insert(
+        std::upper_bound(std::begin(close_group_), std::end(close_group_), id, comparison_), id);
+    if (close_group_.size() > GroupSize()) {
+      // the furthest member of our close group drops out of it
+      CountOutsideCloseGroup(BucketIndex(close_group_.back()), true);
+      close_group_.pop_back();
+    }
+  } else {
+    CountOutsideCloseGroup(bucket_index, true);
+  }
+  auto& bucket(MutableBucket(bucket_index));
+  auto position(std::upper_bound(std::begin(bucket.ids), std::end(bucket.ids), id, comparison_) -
+                std::begin(bucket.ids));
+  bucket.ids.insert(std::begin(bucket.ids) + position, id);
+  bucket.nodes.insert(std::begin(bucket.nodes) + position, node);
+  auto added(node.get());
+  nodes_.emplace(id, std::move(node));
+  return added;
+}
+
+template <typename NetworkParameters>
+NodeInfo BasicRoutingTable<NetworkParameters>::RemoveNode(RawAddress their_id) {
+  auto node_itr(nodes_.find(their_id));
+  assert(node_itr != std::end(nodes_));
+  auto bucket_index(BucketIndex(their_id));
+  auto bucket_itr(buckets_.find(bucket_index));
+  assert(bucket_itr != std::end(buckets_));
+  auto& bucket(MutableBucket(bucket_itr->second));
+  auto itr(std::lower_bound(std::begin(bucket.ids), std::end(bucket.ids), their_id, comparison_));
+  assert(itr != std::end(bucket.ids) && *itr == their_id);
+  bucket.nodes.erase(std::begin(bucket.nodes) + (itr - std::begin(bucket.ids)));
+  bucket.ids.erase(itr);
+  if (bucket.ids.empty())
+    buckets_.erase(bucket_itr);
+
+  auto group_itr(std::find(std::begin(close_group_), std::end(close_group_), their_id));
+  if (group_itr != std::end(close_group_)) {
+    close_group_.erase(group_itr);
+    // the next closest contact (if any) moves into our close group
+    const RawAddress* next(nullptr);
+    if (!close_group_.empty())
+      next = NextFurther(close_group_.back());
+    else if (!buckets_.empty())
+      next = &buckets_.begin()->second->ids.front();
+    if (next) {
+      CountOutsideCloseGroup(BucketIndex(*next), false);
+      close_group_.push_back(*next);
+    }
+  } else {
+    CountOutsideCloseGroup(bucket_index, false);
+  }
+
+  // the contact may still be referenced by a snapshot, so it can't be moved from
+  NodeInfo removed(*node_itr->second);
+  nodes_.erase(node_itr);
+  return removed;
+}
+
+template <typename NetworkParameters>
+const RawAddress* BasicRoutingTable<NetworkParameters>::NextFurther(const RawAddress& id) const {
+  auto bucket_itr(buckets_.find(BucketIndex(id)));
+  assert(bucket_itr != std::end(buckets_));
+  const auto& ids(bucket_itr->second->ids);
+  auto itr(std::upper_bound(std::begin(ids), std::end(ids), id, comparison_));
+  if (itr != std::end(ids))
+    return &*itr;
+  return ++bucket_itr == std::end(buckets_) ? nullptr : &bucket_itr->second->ids.front();
+}
+
+template <typename NetworkParameters>
+int32_t BasicRoutingTable<NetworkParameters>::FindBucketForRemoval() const {
+  for (size_t i(0); i < over_capacity_.size(); ++i) {
+    if (over_capacity_[i] != 0)
+      return static_cast<int32_t>(i * 32 + detail::CountTrailingZeros(over_capacity_[i]));
+  }
+  return -1;
+}
+
+template <typename NetworkParameters>
+const RawAddress& BasicRoutingTable<NetworkParameters>::FindCandidateForRemoval(
+    int32_t removal_bucket) const {
+  auto bucket_itr(buckets_.find(removal_bucket));
+  assert(bucket_itr != std::end(buckets_));
+  // the bucket's contacts outside our close group are its furthest ones
+  const auto& ids(bucket_itr->second->ids);
+  assert(ids.size() > BucketSize());
+  return ids[ids.size() - BucketSize()];
+}
+
+template <typename NetworkParameters>
+void BasicRoutingTable<NetworkParameters>::CountOutsideCloseGroup(int32_t bucket_index,
+                                                                  bool added) {
+  auto& count(outside_close_group_[bucket_index]);
+  if (added) {
+    ++count;
+  } else {
+    assert(count != 0);
+    --count;
+  }
+  auto& word(over_capacity_[bucket_index / 32]);
+  auto bit(uint32_t(1) << (bucket_index % 32));
+  if (count > BucketSize())
+    word |= bit;
+  else
+    word &= ~bit;
+}
+
+template <typename NetworkParameters>
+void BasicRoutingTable<NetworkParameters>::CacheReplacement(int32_t bucket_index,
+                                                            NodeInfo their_info,
+                                                            EndpointPair their_endpoints) {
+  if (ReplacementCacheSize() == 0 || !IsSet(their_endpoints))
+    return;
+  UncacheReplacement(bucket_index, their_info.id);
+  auto& cache(replacements_[bucket_index]);
+  cache.push_back(Replacement{std::move(their_info), std::move(their_endpoints)});
+  if (cache.size() > ReplacementCacheSize())
+    cache.pop_front();
+}
+
+template <typename NetworkParameters>
+void BasicRoutingTable<NetworkParameters>::UncacheReplacement(int32_t bucket_index,
+                                                              const Address& their_id) {
+  auto cache_itr(replacements_.find(bucket_index));
+  if (cache_itr == std::end(replacements_))
+    return;
+  auto& cache(cache_itr->second);
+  auto itr(std::find_if(std::begin(cache), std::end(cache), [&](const Replacement& replacement) {
+    return replacement.node_info.id == their_id;
+  }));
+  if (itr == std::end(cache))
+    return;
+  cache.erase(itr);
+  if (cache.empty())
+    replacements_.erase(cache_itr);
+}
+
+template <typename NetworkParameters>
+boost::optional<typename BasicRoutingTable<NetworkParameters>::Replacement>
+BasicRoutingTable<NetworkParameters>::PromoteReplacement(int32_t bucket_index) {
+  if (nodes_.size() >= OptimalSize() || replacements_.empty())
+    return boost::none;
+  // prefer a replacement from the same bucket, otherwise take one from the closest bucket
+  auto cache_itr(replacements_.find(bucket_index));
+  if (cache_itr == std::end(replacements_))
+    cache_itr = std::prev(std::end(replacements_));
+  auto& cache(cache_itr->second);
+  Replacement promoted(std::move(cache.back()));
+  cache.pop_back();
+  if (cache.empty())
+    replacements_.erase(cache_itr);
+  InsertNode(promoted.node_info);
+  return std::move(promoted);
+}
+
+template <typename NetworkParameters>
+typename BasicRoutingTable<NetworkParameters>::Contacts&
+BasicRoutingTable<NetworkParameters>::MutableBucket(Bucket& bucket) {
+  // Snapshots only gain a reference to a bucket under 'mutex_', so if the table holds the only
+  // one, no reader can see the bucket change.
+  if (!bucket)
+    bucket = std::make_shared<Contacts>();
+  else if (bucket.use_count() != 1)
+    bucket = std::make_shared<Contacts>(*bucket);
+  return *bucket;
+}
+
+template <typename NetworkParameters>
+typename BasicRoutingTable<NetworkParameters>::Contacts&
+BasicRoutingTable<NetworkParameters>::MutableBucket(int32_t bucket_index) {
+  return MutableBucket(buckets_[bucket_index]);
+}
+
+template <typename NetworkParameters>
+void BasicRoutingTable<NetworkParameters>::PublishSnapshot() {
+  auto snapshot(std::make_shared<Snapshot>());
+  snapshot->buckets.reserve(buckets_.size());
+  for (const auto& bucket : buckets_)
+    snapshot->buckets.emplace_back(bucket.first, bucket.second);
+  snapshot->size = nodes_.size();
+  std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
+
+template <typename NetworkParameters>
+std::shared_ptr<const typename BasicRoutingTable<NetworkParameters>::Snapshot>
+BasicRoutingTable<NetworkParameters>::LoadSnapshot() const {
+  return std::atomic_load(&snapshot_);
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
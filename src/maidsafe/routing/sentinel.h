@@ -19,36 +19,49 @@
 #ifndef MAIDSAFE_ROUTING_SENTINEL_H_
 #define MAIDSAFE_ROUTING_SENTINEL_H_
 
+#include <algorithm>
 #include <chrono>
 #include <future>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 #include <utility>
 
 #include "asio/io_service.hpp"
 #include "boost/optional/optional.hpp"
+#include "cereal/types/utility.hpp"
 
+#include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/rsa.h"
 
+#include "maidsafe/routing/account_transfer_info.h"
 #include "maidsafe/routing/accumulator.h"
 #include "maidsafe/routing/message_header.h"
 #include "maidsafe/routing/types.h"
+#include "maidsafe/routing/messages/get_client_key_response.h"
+#include "maidsafe/routing/messages/get_group_key_response.h"
 #include "maidsafe/routing/messages/messages_fwd.h"
 
 namespace maidsafe {
 
 namespace routing {
 
-class Sentinel {
+// The quorum required of group messages is taken from the 'NetworkParameters' policy (see
+// 'DefaultNetworkParameters'); 'Sentinel' is the sentinel for the stock network.
+template <typename NetworkParameters>
+class BasicSentinel {
  public:
   // TODO(mmoadeli): ResultType below may have extra information which could be removed later
   using ResultType = std::tuple<MessageHeader, MessageTypeTag, SerialisedMessage>;
-  Sentinel(SendGetClientKey send_get_client_key, SendGetGroupKey send_get_group_key)
+  BasicSentinel(SendGetClientKey send_get_client_key, SendGetGroupKey send_get_group_key)
       : send_get_client_key_(send_get_client_key), send_get_group_key_(send_get_group_key) {}
-  Sentinel(const Sentinel&) = delete;
-  Sentinel(Sentinel&&) = delete;
-  ~Sentinel() = default;
-  Sentinel& operator=(const Sentinel&) = delete;
-  Sentinel& operator=(Sentinel&&) = delete;
+  BasicSentinel(const BasicSentinel&) = delete;
+  BasicSentinel(BasicSentinel&&) = delete;
+  ~BasicSentinel() = default;
+  BasicSentinel& operator=(const BasicSentinel&) = delete;
+  BasicSentinel& operator=(BasicSentinel&&) = delete;
   // at some stage this will return a valid answer when all data is accumulated
   // and signatures checked
   boost::optional<ResultType> Add(MessageHeader, MessageTypeTag, SerialisedMessage);
@@ -56,15 +69,17 @@ class Sentinel {
  private:
   using NodeKeyType = std::pair<NodeAddress, routing::MessageId>;
   using GroupKeyType = std::pair<GroupAddress, routing::MessageId>;
-  using NodeAccumulatorType = Accumulator<NodeKeyType, ResultType>;
-  using GroupAccumulatorType = Accumulator<GroupKeyType, ResultType>;
-  using KeyAccumulatorType = Accumulator<GroupAddress, ResultType>;
+  using NodeAccumulatorType = Accumulator<NodeKeyType, ResultType, NetworkParameters>;
+  using GroupAccumulatorType = Accumulator<GroupKeyType, ResultType, NetworkParameters>;
+  using KeyAccumulatorType = Accumulator<GroupAddress, ResultType, NetworkParameters>;
   using GroupMessage = std::true_type;
   using SingleMessage = std::false_type;
 
-  template <typename AccumulatorType, typename AccumulatorKeyType>
-  std::vector<ResultType> Validate(const typename AccumulatorType::Map& messages,
-                                   const typename AccumulatorKeyType::Map& keys);
+  std::vector<ResultType> Validate(const typename NodeAccumulatorType::Map& messages,
+                                   const typename KeyAccumulatorType::Map& keys, SingleMessage);
+
+  std::vector<ResultType> Validate(const typename GroupAccumulatorType::Map& messages,
+                                   const typename KeyAccumulatorType::Map& keys, GroupMessage);
 
   boost::optional<ResultType>
   Resolve(const std::vector<ResultType>& verified_messages, GroupMessage);
@@ -75,22 +90,240 @@ class Sentinel {
   SendGetClientKey send_get_client_key_;
   SendGetGroupKey send_get_group_key_;
   NodeAccumulatorType node_accumulator_{std::chrono::minutes(20), 1U};
-  GroupAccumulatorType group_accumulator_{std::chrono::minutes(20), QuorumSize};
-  KeyAccumulatorType group_key_accumulator_{std::chrono::minutes(20), QuorumSize};
-  KeyAccumulatorType node_key_accumulator_{std::chrono::minutes(20), QuorumSize};
+  GroupAccumulatorType group_accumulator_{std::chrono::minutes(20)};
+  KeyAccumulatorType group_key_accumulator_{std::chrono::minutes(20)};
+  KeyAccumulatorType node_key_accumulator_{std::chrono::minutes(20)};
 };
 
-template <>
-std::vector<Sentinel::ResultType>
-Sentinel::Validate<Sentinel::NodeAccumulatorType, Sentinel::KeyAccumulatorType>(
-    const typename Sentinel::NodeAccumulatorType::Map& messages,
-    const typename Sentinel::KeyAccumulatorType::Map& keys);
-
-template <>
-std::vector<Sentinel::ResultType>
-Sentinel::Validate<Sentinel::GroupAccumulatorType, Sentinel::KeyAccumulatorType>(
-    const typename Sentinel::GroupAccumulatorType::Map& messages,
-    const typename Sentinel::KeyAccumulatorType::Map& keys);
+using Sentinel = BasicSentinel<DefaultNetworkParameters>;
+
+template <typename NetworkParameters>
+boost::optional<typename BasicSentinel<NetworkParameters>::ResultType>
+BasicSentinel<NetworkParameters>::Add(MessageHeader header, MessageTypeTag tag,
+                                      SerialisedMessage message) {
+  if (tag == MessageTypeTag::GetClientKeyResponse) {
+    if (!header.FromGroup())  // keys should always come from a group, one reponse should be enough
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    auto keys(node_key_accumulator_.Add(*header.FromGroup(),
+                                        std::make_tuple(header, tag, std::move(message)),
+                                        header.FromNode()));
+    if (keys) {
+      auto key(std::make_pair(NodeAddress(header.FromGroup()->data), header.MessageId()));
+      auto messages(node_accumulator_.GetAll(key));
+      if (messages) {
+        auto resolved(Resolve(Validate(messages->second, keys->second, SingleMessage()),
+                              SingleMessage()));
+        if (resolved) {
+          node_accumulator_.Delete(key);
+          return resolved;
+        }
+      }
+    }
+  } else if (tag == MessageTypeTag::GetGroupKeyResponse) {
+    if (!header.FromGroup())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    auto keys(group_key_accumulator_.Add(*header.FromGroup(),
+                                         std::make_tuple(header, tag, std::move(message)),
+                                         header.FromNode()));
+    if (keys) {
+      auto key(std::make_pair(*header.FromGroup(), header.MessageId()));
+      auto messages(group_accumulator_.GetAll(key));
+      if (messages) {
+        auto resolved(Resolve(Validate(messages->second, keys->second, GroupMessage()),
+                              GroupMessage()));
+        if (resolved) {
+          group_accumulator_.Delete(key);
+          return resolved;
+        }
+      }
+    }
+  } else {
+    if (header.FromGroup()) {
+      auto key(std::make_pair(*header.FromGroup(), header.MessageId()));
+      if (!group_accumulator_.HaveName(key))
+        send_get_group_key_(*header.FromGroup());
+      auto messages(group_accumulator_.Add(key, std::make_tuple(header, tag, std::move(message)),
+                                           header.FromNode()));
+      if (messages) {
+        auto keys(group_key_accumulator_.GetAll(*header.FromGroup()));
+        if (keys) {
+          auto resolved(Resolve(Validate(messages->second, keys->second, GroupMessage()),
+                                GroupMessage()));
+          if (resolved) {
+            group_accumulator_.Delete(key);
+            return resolved;
+          }
+        }
+      }
+    } else {
+      auto key(std::make_pair(header.FromNode(), header.MessageId()));
+      if (!node_accumulator_.HaveName(key))
+        send_get_client_key_(header.FromNode());
+      auto messages(node_accumulator_.Add(key, std::make_tuple(header, tag, std::move(message)),
+                                          header.FromNode()));
+      if (messages) {
+        auto keys(node_accumulator_.GetAll(messages->first));
+        if (keys) {
+          auto resolved(Resolve(Validate(messages->second, keys->second, SingleMessage()),
+                                SingleMessage()));
+          if (resolved) {
+            node_accumulator_.Delete(key);
+            return resolved;
+          }
+        }
+      }
+    }
+  }
+  return boost::none;
+}
+
+template <typename NetworkParameters>
+std::vector<typename BasicSentinel<NetworkParameters>::ResultType>
+BasicSentinel<NetworkParameters>::Validate(const typename NodeAccumulatorType::Map& messages,
+                                           const typename KeyAccumulatorType::Map& keys,
+                                           SingleMessage) {
+  if (messages.empty() || keys.size() < NetworkParameters::QuorumSize)
+    return std::vector<ResultType>();
+
+  std::vector<ResultType>  verified_messages;
+  std::map<Address, std::vector<asymm::PublicKey>> keys_map;
+
+  for (const auto& node_key : keys) {
+    auto key(Parse<GetClientKeyResponse>(std::get<2>(node_key.second)));
+    if (keys_map.find(key.address()) == keys_map.end()) {
+      keys_map.insert(std::make_pair(key.address(),
+                                     std::vector<asymm::PublicKey> {key.public_key()}));
+    } else {
+      auto& public_keys(keys_map[key.address()]);
+      if (std::none_of(public_keys.begin(), public_keys.end(),
+                       [&](const asymm::PublicKey& public_key) {
+                         return Serialise(key.public_key()) == Serialise(public_key);
+                       }))
+        keys_map[key.address()].push_back(key.public_key());
+    }
+  }
+
+  // TODO(mmoadeli): Following checks that returned public keys from all nodes are identical.
+  //  This could be changed in futute. And lying node to be reported.
+  assert(keys_map.size() == 1);
+  assert(keys_map.begin()->second.size() == 1);
+
+  auto& public_key(*keys_map.begin()->second.begin());
+  if (!asymm::ValidateKey(public_key))
+    return std::vector<ResultType>();
+
+  for (const auto& message : messages) {
+    auto signature(std::get<0>(message.second).Signature());
+    if (signature && asymm::CheckSignature(
+          rsa::PlainText(std::get<2>(message.second)), *signature, public_key))
+      verified_messages.emplace_back(message.second);
+  }
+
+  if (verified_messages.size() >= 1)
+    return verified_messages;
+
+  return std::vector<ResultType>();
+}
+
+template <typename NetworkParameters>
+std::vector<typename BasicSentinel<NetworkParameters>::ResultType>
+BasicSentinel<NetworkParameters>::Validate(const typename GroupAccumulatorType::Map& messages,
+                                           const typename KeyAccumulatorType::Map& keys,
+                                           GroupMessage) {
+  if (messages.size() < NetworkParameters::QuorumSize ||
+      keys.size() < NetworkParameters::QuorumSize)
+    return std::vector<ResultType>();
+
+  std::vector<ResultType>  verified_messages;
+  std::map<Address, std::vector<asymm::PublicKey>> keys_map;
+
+  for (const auto& group_keys : keys) {
+    auto group_key_response(Parse<GetGroupKeyResponse>(std::get<2>(group_keys.second)));
+    auto public_keys(group_key_response.public_keys());
+    for (const auto& public_key : public_keys) {
+      if (keys_map.find(public_key.first) == keys_map.end()) {
+        keys_map.insert(std::make_pair(public_key.first,
+                                       std::vector<asymm::PublicKey> {public_key.second}));
+      } else {
+        auto& existing_public_keys(keys_map[public_key.first]);
+        if (std::none_of(existing_public_keys.begin(), existing_public_keys.end(),
+                         [&](const asymm::PublicKey& entry) {
+                           return Serialise(public_key.second) == Serialise(entry);
+                         }))
+          keys_map[public_key.first].push_back(public_key.second);
+      }
+    }
+  }
+
+  // TODO(mmoadeli): For the time being, we assume that no invalid public is received
+  for (const auto& key_map : keys_map) {
+    assert(key_map.second.size() == 1);
+    static_cast<void>(key_map);
+  }
+
+  for (const auto& message : messages) {
+    auto keys_map_iter = keys_map.find(std::get<0>(message.second).FromNode());
+    if (keys_map_iter == keys_map.end())
+      continue;
+
+    auto public_key(*keys_map_iter->second.begin());
+    if (!asymm::ValidateKey(public_key))
+      continue;
+
+    auto signature(std::get<0>(message.second).Signature());
+    if (signature && asymm::CheckSignature(
+          rsa::PlainText(std::get<2>(message.second)), *signature, public_key))
+      verified_messages.emplace_back(message.second);
+  }
+
+  if (verified_messages.size() >= NetworkParameters::QuorumSize)
+    return verified_messages;
+
+  return std::vector<ResultType>();
+}
+
+template <typename NetworkParameters>
+boost::optional<typename BasicSentinel<NetworkParameters>::ResultType>
+BasicSentinel<NetworkParameters>::Resolve(const std::vector<ResultType>& verified_messages,
+                                          GroupMessage) {
+  if (verified_messages.size() < NetworkParameters::QuorumSize)
+    return boost::none;
+
+  // if part addresses non-account transfer message types, where an exact match is required
+  if (std::get<1>(*verified_messages.begin()) != MessageTypeTag::AccountTransfer) {
+    for (size_t index(0); index < verified_messages.size(); ++index) {
+      auto& serialised_message(std::get<2>(verified_messages.at(index)));
+      if (std::count_if(verified_messages.begin(), verified_messages.end(),
+                        [&](const ResultType& result) {
+                            return std::get<2>(result) == serialised_message;
+                        }) >= static_cast<typename std::vector<ResultType>::difference_type>(
+                            NetworkParameters::QuorumSize))
+        return verified_messages.at(index);
+    }
+  } else {  // account transfer
+    std::vector<std::unique_ptr<AccountTransferInfo>> accounts;
+    for (const auto& message : verified_messages)
+       accounts.emplace_back(Parse<std::unique_ptr<AccountTransferInfo>>(std::get<2>(message)));
+    auto merged_value_ptr((*accounts.begin())->Merge(accounts));
+    if (merged_value_ptr) {
+      auto result(*verified_messages.begin());
+      std::get<2>(result) = Serialise(merged_value_ptr);
+      return result;
+    }
+  }
+
+  return boost::none;
+}
+
+template <typename NetworkParameters>
+boost::optional<typename BasicSentinel<NetworkParameters>::ResultType>
+BasicSentinel<NetworkParameters>::Resolve(const std::vector<ResultType>& verified_messages,
+                                          SingleMessage) {
+  if (verified_messages.empty())
+    return boost::none;
+
+  return verified_messages.at(0);
+}
 
 }  // namespace routing
 
@@ -0,0 +1,105 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/batch_frame.h"
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+SharedMessage RandomMessage(size_t size) {
+  auto random(RandomString(size));
+  return MakeSharedMessage(SerialisedMessage(random.begin(), random.end()));
+}
+
+}  // unnamed namespace
+
+TEST(BatchFrameTest, BEH_RoundTrip) {
+  std::vector<SharedMessage> messages{RandomMessage(1), RandomMessage(0), RandomMessage(300),
+                                      RandomMessage(17)};
+  auto frame(MakeBatchFrame(messages));
+  EXPECT_EQ(BatchFrameOverhead(4) + 318, frame.size());
+  ASSERT_TRUE(IsBatchFrame(frame));
+
+  auto parsed(ParseBatchFrame(frame));
+  ASSERT_EQ(messages.size(), parsed.size());
+  for (size_t i(0); i < messages.size(); ++i)
+    EXPECT_EQ(*messages[i], parsed[i]);
+
+  EXPECT_TRUE(ParseBatchFrame(MakeBatchFrame(std::vector<SharedMessage>())).empty());
+}
+
+// A message held as several buffers is framed as their concatenation.
+TEST(BatchFrameTest, BEH_MessagesAsBuffers) {
+  std::vector<SharedBuffers> messages{{RandomMessage(5), RandomMessage(0), RandomMessage(40)},
+                                      {RandomMessage(7)}};
+  std::vector<SharedMessage> joined;
+  for (const auto& message : messages) {
+    SerialisedMessage bytes;
+    for (const auto& buffer : message)
+      bytes.insert(bytes.end(), buffer->begin(), buffer->end());
+    joined.push_back(MakeSharedMessage(std::move(bytes)));
+  }
+  EXPECT_EQ(MakeBatchFrame(joined), MakeBatchFrame(messages));
+}
+
+TEST(BatchFrameTest, BEH_OrdinaryMessagesAreNotFrames) {
+  EXPECT_FALSE(IsBatchFrame(SerialisedMessage()));
+  for (size_t size : {1, 9, 10, 100}) {
+    EXPECT_FALSE(IsBatchFrame(*RandomMessage(size)));
+    EXPECT_THROW(ParseBatchFrame(*RandomMessage(size)), common_error);
+  }
+}
+
+TEST(BatchFrameTest, BEH_MalformedFrames) {
+  auto frame(MakeBatchFrame({RandomMessage(20), RandomMessage(30)}));
+
+  // truncated, within a size prefix and within a message
+  for (size_t size : {frame.size() - 1, frame.size() - 31, BatchFrameOverhead(1) + 21}) {
+    SerialisedMessage truncated(frame.begin(), frame.begin() + size);
+    EXPECT_THROW(ParseBatchFrame(truncated), common_error) << size;
+  }
+
+  // trailing bytes
+  auto extended(frame);
+  extended.push_back(0);
+  EXPECT_THROW(ParseBatchFrame(extended), common_error);
+
+  // a message size running past the end of the frame
+  auto oversized(frame);
+  oversized[BatchFrameOverhead(0) + 3] = 0x80;
+  EXPECT_THROW(ParseBatchFrame(oversized), common_error);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
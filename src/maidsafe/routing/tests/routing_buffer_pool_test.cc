@@ -0,0 +1,102 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/buffer_pool.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(BufferPoolTest, BEH_SizeClasses) {
+  EXPECT_EQ(4096U, BufferPool::SizeClass(0));
+  EXPECT_EQ(4096U, BufferPool::SizeClass(1));
+  EXPECT_EQ(4096U, BufferPool::SizeClass(4096));
+  EXPECT_EQ(65536U, BufferPool::SizeClass(4097));
+  EXPECT_EQ(262144U, BufferPool::SizeClass(262144));
+  EXPECT_EQ(1048576U, BufferPool::SizeClass(262145));
+  EXPECT_EQ(1048576U, BufferPool::SizeClass(1048576));
+  EXPECT_EQ(0U, BufferPool::SizeClass(1048577));
+}
+
+TEST(BufferPoolTest, BEH_BorrowAndReturn) {
+  BufferPool pool(2);
+  {
+    auto buffer(pool.Borrow(1048576));
+    ASSERT_EQ(1048576U, buffer.size());
+    EXPECT_EQ(0U, reinterpret_cast<std::uintptr_t>(buffer.data()) % BufferPool::kPageSize);
+    EXPECT_EQ(0U, pool.GetStats().hits);
+    EXPECT_EQ(1U, pool.GetStats().misses);
+    EXPECT_EQ(1048576U, pool.GetStats().bytes_in_use);
+  }
+  EXPECT_EQ(0U, pool.GetStats().bytes_in_use);
+
+  // Should reuse the returned slab
+  auto buffer(pool.Borrow(1000000));
+  EXPECT_EQ(1048576U, buffer.size());
+  EXPECT_EQ(1U, pool.GetStats().hits);
+  EXPECT_EQ(1U, pool.GetStats().misses);
+
+  // Moving shouldn't affect the accounting
+  auto moved(std::move(buffer));
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(1048576U, pool.GetStats().bytes_in_use);
+  moved.Release();
+  EXPECT_TRUE(moved.empty());
+  EXPECT_EQ(0U, pool.GetStats().bytes_in_use);
+
+  // Oversized requests are never pooled
+  {
+    auto oversized(pool.Borrow(2 * 1048576));
+    EXPECT_EQ(2U * 1048576U, oversized.size());
+    EXPECT_EQ(2U * 1048576U, pool.GetStats().bytes_in_use);
+  }
+  EXPECT_EQ(0U, pool.GetStats().bytes_in_use);
+  pool.Borrow(2 * 1048576);
+  EXPECT_EQ(1U, pool.GetStats().hits);
+  EXPECT_EQ(3U, pool.GetStats().misses);
+}
+
+TEST(BufferPoolTest, BEH_FreeListIsBounded) {
+  const std::size_t max_free(4);
+  BufferPool pool(max_free);
+  {
+    std::vector<BufferPool::Buffer> buffers;
+    for (std::size_t i(0); i < 2 * max_free; ++i)
+      buffers.push_back(pool.Borrow(4096));
+    EXPECT_EQ(2 * max_free, pool.GetStats().misses);
+    EXPECT_EQ(2 * max_free * 4096, pool.GetStats().bytes_in_use);
+  }
+  std::vector<BufferPool::Buffer> buffers;
+  for (std::size_t i(0); i < 2 * max_free; ++i)
+    buffers.push_back(pool.Borrow(4096));
+  EXPECT_EQ(max_free, pool.GetStats().hits);
+  EXPECT_EQ(3 * max_free, pool.GetStats().misses);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,216 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/compact_header.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "maidsafe/common/serialisation/binary_archive.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/message_buffers.h"
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/message_view.h"
+#include "maidsafe/routing/messages/messages.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// Headers with each combination of the optional addresses and signature, and both small and large
+// message IDs.
+std::vector<MessageHeader> Headers() {
+  std::vector<MessageHeader> headers;
+  auto signature(asymm::Sign(asymm::PlainText(RandomString(identity_size)),
+                             asymm::GenerateKeyPair().private_key));
+  for (int i(0); i < 16; ++i) {
+    DestinationAddress destination(Destination(MakeIdentity()), boost::none);
+    if (i & 1)
+      destination.second = ReplyToAddress(MakeIdentity());
+    SourceAddress source(NodeAddress(MakeIdentity()), boost::none, boost::none);
+    if (i & 2)
+      source.group_address = GroupAddress(MakeIdentity());
+    else if (i & 4)
+      source.reply_to_address = ReplyToAddress(MakeIdentity());
+    MessageId message_id((i & 8) ? RandomUint32() | 0x80000000 : RandomUint32() % 128);
+    if (i & 4) {
+      headers.emplace_back(destination, source, message_id, Authority::nae_manager, signature);
+    } else {
+      headers.emplace_back(destination, source, message_id, Authority::client);
+    }
+  }
+  return headers;
+}
+
+SerialisedMessage Joined(const SharedBuffers& buffers) {
+  SerialisedMessage joined;
+  for (const auto& buffer : buffers)
+    joined.insert(joined.end(), buffer->begin(), buffer->end());
+  return joined;
+}
+
+}  // anonymous namespace
+
+TEST(CompactHeaderTest, BEH_SerialiseParse) {
+  for (const auto& header : Headers()) {
+    auto compact(SerialiseCompactHeader(header));
+    ASSERT_TRUE(IsCompactHeader(compact));
+    EXPECT_EQ(CompactHeaderVersion(), compact.front());
+    EXPECT_LT(compact.size(), Serialise(header).size());
+    EXPECT_FALSE(IsCompactHeader(Serialise(header)));
+
+    // the header is parsed from the start of a message, so needn't end it
+    compact.push_back(0xff);
+    std::size_t size(0);
+    EXPECT_EQ(header, ParseCompactHeader(compact, size));
+    EXPECT_EQ(compact.size() - 1, size);
+
+    auto fields(ReadCompactHeaderFields(compact));
+    EXPECT_EQ(header.Destination().first, fields.destination);
+    EXPECT_EQ(header.FromNode(), fields.from_node);
+    EXPECT_EQ(header.ReplyToAddress(), fields.reply_to_address);
+    EXPECT_EQ(header.MessageId(), fields.message_id);
+    EXPECT_EQ(size, fields.size);
+  }
+}
+
+TEST(CompactHeaderTest, BEH_Malformed) {
+  auto header(GetRandomMessageHeader());
+  const auto compact(SerialiseCompactHeader(header));
+  std::size_t size(0);
+
+  for (std::size_t length(0); length < compact.size(); ++length) {
+    SerialisedMessage truncated(compact.begin(), compact.begin() + length);
+    EXPECT_THROW(ParseCompactHeader(truncated, size), common_error) << length;
+  }
+
+  auto other_version(compact);
+  other_version[0] = CompactHeaderVersion() + 1;
+  EXPECT_TRUE(IsCompactHeader(other_version));
+  EXPECT_THROW(ParseCompactHeader(other_version, size), common_error);
+
+  auto unknown_presence(compact);
+  unknown_presence[1] |= 0x80;
+  EXPECT_THROW(ParseCompactHeader(unknown_presence, size), common_error);
+
+  auto unknown_authority(compact);
+  unknown_authority[2] = 0xff;
+  EXPECT_THROW(ParseCompactHeader(unknown_authority, size), common_error);
+}
+
+// A message with a compact header is read by 'MessageView' just as one with a cereal header is.
+TEST(CompactHeaderTest, BEH_MessageView) {
+  for (const auto& header : Headers()) {
+    PutData body(DataTypeId(RandomUint32()), RandomBytes(1, 1000));
+    MessageView view(MakeSharedMessage(
+        Joined(SerialiseCompactBuffers(header, MessageTypeTag::PutData, body))));
+    EXPECT_EQ(header.Destination().first, view.Destination());
+    EXPECT_EQ(header.FromNode(), view.FromNode());
+    EXPECT_EQ(header.MessageId(), view.MessageId());
+    EXPECT_EQ(header.ReplyToAddress(), view.ReplyToAddress());
+    EXPECT_EQ(MessageTypeTag::PutData, view.Tag());
+    EXPECT_EQ(header, view.Header());
+    auto parsed(view.ParseBody<PutData>());
+    EXPECT_EQ(body.type_id(), parsed.type_id());
+    EXPECT_EQ(body.data(), parsed.data());
+  }
+}
+
+// The body following a compact header is parsed from the message itself, not from a copy of it.
+TEST(CompactHeaderTest, BEH_MessageViewParsesInPlace) {
+  auto header(GetRandomMessageHeader());
+  PutData body(DataTypeId(RandomUint32()), RandomBytes(1, 1000));
+  auto message(std::make_shared<SerialisedMessage>(
+      Joined(SerialiseCompactBuffers(header, MessageTypeTag::PutData, body))));
+  MessageView view(message);
+  EXPECT_EQ(message.get(), view.Serialised().get());
+  EXPECT_EQ(header, view.Header());
+
+  // The last byte of the message is the last byte of the body's data.
+  message->back() ^= 0xff;
+  auto expected(body.data());
+  expected.back() ^= 0xff;
+  EXPECT_EQ(expected, view.ParseBody<PutData>().data());
+}
+
+// Compares the size of each encoding, and the rate at which each is parsed in full and has its
+// routing fields read by 'MessageView'.
+TEST(CompactHeaderTest, FUNC_SizeAndParseThroughput) {
+  const int iterations(20000);
+  auto headers(Headers());
+  std::vector<SerialisedMessage> cereal, compact;
+  std::vector<SharedMessage> cereal_messages, compact_messages;
+  std::size_t cereal_size(0), compact_size(0);
+  for (const auto& header : headers) {
+    cereal.push_back(Serialise(header));
+    compact.push_back(SerialiseCompactHeader(header));
+    cereal_size += cereal.back().size();
+    compact_size += compact.back().size();
+    cereal_messages.push_back(MakeSharedMessage(Serialise(header, MessageTypeTag::Connect)));
+    compact_messages.push_back(
+        MakeSharedMessage(Joined(SerialiseCompactBuffers(header, MessageTypeTag::Connect,
+                                                         SerialisedMessage()))));
+  }
+  std::cout << "Mean header size:  cereal " << cereal_size / headers.size() << " bytes, compact "
+            << compact_size / headers.size() << " bytes\n";
+
+  auto rate = [&](const std::function<void(std::size_t)>& parse) {
+    auto start(std::chrono::steady_clock::now());
+    for (int i(0); i < iterations; ++i)
+      parse(i % headers.size());
+    return iterations /
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  auto cereal_rate(rate([&](std::size_t i) {
+    InputVectorStream stream(cereal[i]);
+    MessageHeader header;
+    Parse(stream, header);
+    ASSERT_EQ(headers[i].MessageId(), header.MessageId());
+  }));
+  auto compact_rate(rate([&](std::size_t i) {
+    std::size_t size(0);
+    ASSERT_EQ(headers[i].MessageId(), ParseCompactHeader(compact[i], size).MessageId());
+  }));
+  auto cereal_view_rate(rate([&](std::size_t i) {
+    ASSERT_EQ(headers[i].MessageId(), MessageView(cereal_messages[i]).MessageId());
+  }));
+  auto compact_view_rate(rate([&](std::size_t i) {
+    ASSERT_EQ(headers[i].MessageId(), MessageView(compact_messages[i]).MessageId());
+  }));
+  std::cout << "Headers parsed per second:  cereal " << cereal_rate << ", compact " << compact_rate
+            << "\nRouting fields read per second:  cereal " << cereal_view_rate << ", compact "
+            << compact_view_rate << '\n';
+  EXPECT_LT(compact_size, cereal_size);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,184 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <set>
+#include <vector>
+
+#include "asio/io_service.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/connection_manager.h"
+#include "maidsafe/routing/xor_distance.h"
+#include "maidsafe/routing/tests/utils/connection_manager_test_access.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace {
+
+std::atomic<size_t> allocation_count(0);
+
+}  // unnamed namespace
+
+// Counts every heap allocation made by this test executable.
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  if (void* memory = std::malloc(size == 0 ? 1 : size))
+    return memory;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) MAIDSAFE_NOEXCEPT { std::free(memory); }
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+template <typename Function>
+double MicrosecondsPerCall(size_t calls, Function function) {
+  auto start(std::chrono::steady_clock::now());
+  function();
+  auto elapsed(std::chrono::steady_clock::now() - start);
+  return std::chrono::duration<double, std::micro>(elapsed).count() / calls;
+}
+
+// Adds 'count' connected peers, all sharing one fob since generating keys is slow.  Returns their
+// IDs.
+std::vector<Address> AddPeers(ConnectionManager& manager, size_t count) {
+  auto fob(PublicFob());
+  std::vector<Address> ids;
+  for (size_t i(0); i < count; ++i) {
+    ids.push_back(MakeIdentity());
+    ConnectionManagerAccess::AddPeer(manager, NodeInfo(ids.back(), fob, true));
+  }
+  return ids;
+}
+
+// One in every 'kInRangeStride' targets is our own ID, so the close group is flooded; the rest are
+// random so are mostly out of range and the 'Parallelism' closest peers are chosen.
+const size_t kInRangeStride(16);
+
+std::vector<Address> MakeTargets(const ConnectionManager& manager) {
+  std::vector<Address> targets;
+  for (size_t i(0); i < 1024; ++i)
+    targets.push_back(i % kInRangeStride == 0 ? manager.OurId() : MakeIdentity());
+  return targets;
+}
+
+}  // unnamed namespace
+
+// Times 'GetTarget' for managers of 64, 500 and 5000 peers, reporting the allocations per call,
+// against collecting its choice into a distance-ordered std::set (the previous return type).
+TEST(ConnectionManagerBenchmarkTest, FUNC_GetTarget) {
+  const size_t kCalls(100000);
+  for (auto peer_count : {64, 500, 5000}) {
+    asio::io_service io_service;
+    ConnectionManager manager(io_service, PublicFob());
+    AddPeers(manager, peer_count);
+    auto targets(MakeTargets(manager));
+
+    size_t chosen(0);
+    auto allocations_before(allocation_count.load());
+    auto get_target_time(MicrosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i)
+        chosen += manager.GetTarget(targets[i % targets.size()]).size();
+    }));
+    auto get_target_allocations(allocation_count - allocations_before);
+    EXPECT_EQ(0U, get_target_allocations);
+
+    allocations_before = allocation_count;
+    auto set_time(MicrosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i) {
+        const auto& target(targets[i % targets.size()]);
+        auto chosen_targets(manager.GetTarget(target));
+        auto closer([&target](const Address& lhs, const Address& rhs) {
+          return XorCloser(lhs, rhs, target);
+        });
+        std::set<Address, decltype(closer)> result(chosen_targets.begin(), chosen_targets.end(),
+                                                   closer);
+        chosen -= result.size();
+      }
+    }));
+    auto set_allocations(allocation_count - allocations_before);
+    EXPECT_EQ(0U, chosen);
+
+    std::cout << peer_count << " peers:  GetTarget " << get_target_time << " us ("
+              << 1.0 / get_target_time << "M calls/s), "
+              << static_cast<double>(get_target_allocations) / kCalls
+              << " allocations per call;  into a std::set " << set_time << " us, "
+              << static_cast<double>(set_allocations) / kCalls << " allocations per call\n";
+  }
+}
+
+// Times 'FindPeer' and 'IsManaged' for managers of 64, 500 and 5000 peers, with half of the
+// lookups for held peers and half for unknown IDs, against the same lookups in a std::map ordered
+// by distance from us (as the peers were previously held).
+TEST(ConnectionManagerBenchmarkTest, FUNC_FindPeer) {
+  const size_t kCalls(1000000);
+  for (auto peer_count : {64, 500, 5000}) {
+    asio::io_service io_service;
+    ConnectionManager manager(io_service, PublicFob());
+    auto ids(AddPeers(manager, peer_count));
+    auto our_id(manager.OurId());
+    auto closer([&our_id](const Address& lhs, const Address& rhs) {
+      return XorCloser(lhs, rhs, our_id);
+    });
+    std::map<Address, size_t, decltype(closer)> ordered_map(closer);
+    for (size_t i(0); i < ids.size(); ++i)
+      ordered_map.insert(std::make_pair(ids[i], i));
+
+    std::vector<Address> lookups;
+    for (size_t i(0); i < 1024; ++i)
+      lookups.push_back(i % 2 == 0 ? ids[i % ids.size()] : MakeIdentity());
+
+    size_t found(0);
+    auto find_peer_time(MicrosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i)
+        found += manager.FindPeer(lookups[i % lookups.size()]) != nullptr;
+    }));
+    auto is_managed_time(MicrosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i)
+        found -= manager.IsManaged(lookups[i % lookups.size()]);
+    }));
+    auto map_time(MicrosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i)
+        found += ordered_map.find(lookups[i % lookups.size()]) != ordered_map.end();
+    }));
+    EXPECT_EQ(kCalls / 2, found);
+
+    std::cout << peer_count << " peers:  FindPeer " << find_peer_time * 1000 << " ns,  IsManaged "
+              << is_managed_time * 1000 << " ns,  ordered map find " << map_time * 1000
+              << " ns\n";
+  }
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,143 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <vector>
+
+#include "asio/io_service.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/connection_manager.h"
+#include "maidsafe/routing/xor_distance.h"
+#include "maidsafe/routing/tests/utils/connection_manager_test_access.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+const size_t kParallelism(DefaultNetworkParameters::Parallelism);
+
+class ConnectionManagerGetTargetTest : public testing::Test {
+ protected:
+  ConnectionManagerGetTargetTest()
+      : io_service_(), fob_(PublicFob()), manager_(io_service_, fob_), peers_() {}
+
+  // Adds 'count' peers, every 'disconnected_stride'th of which (if non-zero) isn't connected.
+  void AddPeers(size_t count, size_t disconnected_stride = 0) {
+    for (size_t i(0); i < count; ++i) {
+      bool connected(disconnected_stride == 0 || i % disconnected_stride != 0);
+      NodeInfo node_info(MakeIdentity(), fob_, connected);
+      peers_.push_back(node_info);
+      ConnectionManagerAccess::AddPeer(manager_, std::move(node_info));
+    }
+  }
+
+  // What 'GetTarget' should choose, found by sorting all the peers.
+  std::vector<Address> Expected(const Address& target) const {
+    auto by_distance_from([](const Address& id) {
+      return [id](const NodeInfo& lhs, const NodeInfo& rhs) {
+        return XorCloser(lhs.id, rhs.id, id);
+      };
+    });
+    auto peers(peers_);
+    std::vector<Address> expected;
+    if (manager_.AddressInCloseGroupRange(target)) {
+      std::sort(peers.begin(), peers.end(), by_distance_from(manager_.OurId()));
+      peers.resize(std::min(peers.size(), GroupSize));
+    } else {
+      std::sort(peers.begin(), peers.end(), by_distance_from(target));
+    }
+    for (const auto& peer : peers) {
+      if (peer.connected)
+        expected.push_back(peer.id);
+    }
+    if (!manager_.AddressInCloseGroupRange(target))
+      expected.resize(std::min(expected.size(), kParallelism));
+    return expected;
+  }
+
+  std::vector<Address> Actual(const Address& target) const {
+    auto targets(manager_.GetTarget(target));
+    return std::vector<Address>(targets.begin(), targets.end());
+  }
+
+  asio::io_service io_service_;
+  passport::PublicPmid fob_;
+  ConnectionManager manager_;
+  std::vector<NodeInfo> peers_;
+};
+
+TEST_F(ConnectionManagerGetTargetTest, BEH_NoPeers) {
+  EXPECT_TRUE(manager_.GetTarget(MakeIdentity()).empty());
+  EXPECT_TRUE(manager_.GetTarget(manager_.OurId()).empty());
+}
+
+TEST_F(ConnectionManagerGetTargetTest, BEH_FewerThanGroupSize) {
+  // Every address is in range of an incomplete close group, so all peers are chosen.
+  AddPeers(GroupSize - 1);
+  for (int i(0); i < 20; ++i) {
+    auto target(MakeIdentity());
+    EXPECT_EQ(GroupSize - 1, manager_.GetTarget(target).size());
+    EXPECT_EQ(Expected(target), Actual(target));
+  }
+}
+
+TEST_F(ConnectionManagerGetTargetTest, BEH_CloseGroupAndParallelism) {
+  AddPeers(500);
+  EXPECT_EQ(GroupSize, manager_.GetTarget(manager_.OurId()).size());
+  EXPECT_EQ(Expected(manager_.OurId()), Actual(manager_.OurId()));
+  size_t out_of_range(0);
+  for (int i(0); i < 200; ++i) {
+    auto target(MakeIdentity());
+    if (!manager_.AddressInCloseGroupRange(target)) {
+      ++out_of_range;
+      EXPECT_EQ(kParallelism, manager_.GetTarget(target).size());
+    }
+    EXPECT_EQ(Expected(target), Actual(target));
+  }
+  EXPECT_GT(out_of_range, 0U);
+
+  // Outside our close group, a peer's own address is always its closest target.
+  for (const auto& peer : peers_) {
+    if (manager_.AddressInCloseGroupRange(peer.id))
+      continue;
+    auto targets(manager_.GetTarget(peer.id));
+    ASSERT_FALSE(targets.empty());
+    EXPECT_EQ(peer.id, targets[0]);
+  }
+}
+
+TEST_F(ConnectionManagerGetTargetTest, BEH_SkipDisconnectedPeers) {
+  AddPeers(500, 3);
+  for (int i(0); i < 200; ++i) {
+    auto target(MakeIdentity());
+    EXPECT_EQ(Expected(target), Actual(target));
+  }
+  EXPECT_EQ(Expected(manager_.OurId()), Actual(manager_.OurId()));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,279 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "asio/io_service.hpp"
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/buffer_pool.h"
+#include "maidsafe/routing/connection_manager.h"
+#include "maidsafe/routing/xor_distance.h"
+#include "maidsafe/routing/tests/utils/connection_manager_test_access.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+std::vector<Address> SortedByDistanceFrom(const Address& id, std::vector<Address> addresses) {
+  std::sort(addresses.begin(), addresses.end(), [&id](const Address& lhs, const Address& rhs) {
+    return XorCloser(lhs, rhs, id);
+  });
+  return addresses;
+}
+
+// Checks 'manager' holds exactly 'expected', with our close group and its radius to match.
+void ExpectPeers(ConnectionManager& manager, const std::vector<Address>& expected,
+                 const std::vector<Address>& not_expected) {
+  EXPECT_EQ(expected.size(), manager.Size());
+  for (const auto& id : expected) {
+    EXPECT_TRUE(manager.IsManaged(id));
+    auto peer(manager.FindPeer(id));
+    ASSERT_NE(nullptr, peer);
+    EXPECT_EQ(id, peer->id());
+    EXPECT_TRUE(!!manager.GetPublicKey(id));
+  }
+  for (const auto& id : not_expected) {
+    EXPECT_FALSE(manager.IsManaged(id));
+    EXPECT_EQ(nullptr, manager.FindPeer(id));
+    EXPECT_FALSE(!!manager.GetPublicKey(id));
+  }
+
+  auto sorted(SortedByDistanceFrom(manager.OurId(), expected));
+  auto group(manager.OurCloseGroup());
+  ASSERT_EQ(std::min(sorted.size(), GroupSize), group.size());
+  for (size_t i(0); i < group.size(); ++i)
+    EXPECT_EQ(sorted[i], Address(group[i].Name()));
+  if (sorted.size() >= GroupSize)
+    EXPECT_EQ(XorDistanceBetween(manager.OurId(), sorted[GroupSize - 1]),
+              manager.CloseGroupRadius());
+  else
+    EXPECT_TRUE(manager.AddressInCloseGroupRange(MakeIdentity()));
+}
+
+size_t OpenFileDescriptors() {
+#ifdef MAIDSAFE_LINUX
+  return static_cast<size_t>(std::distance(boost::filesystem::directory_iterator("/proc/self/fd"),
+                                           boost::filesystem::directory_iterator()));
+#else
+  return 0;
+#endif
+}
+
+}  // unnamed namespace
+
+TEST(ConnectionManagerPeersTest, BEH_AddFindDrop) {
+  asio::io_service io_service;
+  ConnectionManager manager(io_service, PublicFob());
+  std::vector<Address> held, dropped;
+  // Each node's fob is named by its ID, so the close group's fobs can be checked by name.
+  for (int i(0); i < 300; ++i) {
+    auto fob(PublicFob());
+    held.push_back(Address(fob.Name()));
+    ConnectionManagerAccess::AddPeer(manager, NodeInfo(held.back(), fob, true));
+    if (i == 10 || i == 100)
+      ExpectPeers(manager, held, dropped);
+  }
+  ExpectPeers(manager, held, dropped);
+
+  // Drop singly, including our close group and unknown IDs.
+  for (const auto& id : SortedByDistanceFrom(manager.OurId(), held)) {
+    if (dropped.size() == 10)
+      break;
+    manager.DropNode(id);
+    dropped.push_back(id);
+  }
+  manager.DropNode(MakeIdentity());
+  held.erase(std::remove_if(held.begin(), held.end(), [&](const Address& id) {
+    return std::count(dropped.begin(), dropped.end(), id) != 0;
+  }), held.end());
+  ExpectPeers(manager, held, dropped);
+
+  // Drop a batch of every third peer by distance (so including our closest), with an unknown ID
+  // and a repeat mixed in.
+  std::vector<Address> batch{MakeIdentity(), dropped.front()};
+  std::vector<Address> kept;
+  held = SortedByDistanceFrom(manager.OurId(), held);
+  for (size_t i(0); i < held.size(); ++i)
+    (i % 3 == 0 ? batch : kept).push_back(held[i]);
+  EXPECT_TRUE(!!manager.DropNodes(batch));
+  dropped.insert(dropped.end(), batch.begin(), batch.end());
+  ExpectPeers(manager, kept, dropped);
+
+  // Re-adding a held peer is ignored.
+  ConnectionManagerAccess::AddPeer(manager, NodeInfo(kept.front(), PublicFob(), true));
+  ExpectPeers(manager, kept, dropped);
+
+  manager.Shutdown();
+  ExpectPeers(manager, std::vector<Address>(), kept);
+}
+
+// Only peers we connected to are snapshotted, since we don't know where those which connected to us
+// accept connections.
+TEST(ConnectionManagerPeersTest, BEH_SnapshotOmitsInboundPeers) {
+  asio::io_service io_service;
+  ConnectionManager manager(io_service, PublicFob());
+  auto outbound_fob(PublicFob()), inbound_fob(PublicFob());
+  Address outbound(outbound_fob.Name()), inbound(inbound_fob.Name());
+  EndpointPair endpoints(EndpointPair::Endpoint(address_v4::loopback(), 5483));
+  ConnectionManagerAccess::Connect(manager, NodeInfo(outbound, outbound_fob, true), endpoints);
+  ConnectionManagerAccess::Connect(manager, NodeInfo(inbound, inbound_fob, true));
+  ASSERT_TRUE(manager.IsManaged(outbound));
+  ASSERT_TRUE(manager.IsManaged(inbound));
+
+  auto snapshot(manager.Snapshot());
+  ASSERT_EQ(1U, snapshot.size());
+  EXPECT_EQ(outbound, snapshot.front().node_info.id);
+  EXPECT_EQ(endpoints, snapshot.front().endpoint_pair);
+  manager.Shutdown();
+}
+
+// Many more peers connect than the routing table will hold: only those it holds are kept, and the
+// sockets (and with them any receive buffers and file descriptors) of the rest are released.
+TEST(ConnectionManagerPeersTest, BEH_ConnectStorm) {
+  const size_t kPeerCount(2000);
+  const size_t kMaxPeers(RoutingTable::OptimalSize());
+  asio::io_service io_service;
+  ConnectionManager manager(io_service, PublicFob());
+  // Key generation is slow, so the peers share a fob.
+  const auto fob(PublicFob());
+  std::vector<Address> offered;
+  std::vector<std::weak_ptr<crux::socket>> sockets;
+  size_t descriptors_when_full(0);
+  for (size_t i(0); i < kPeerCount; ++i) {
+    offered.push_back(MakeIdentity());
+    sockets.push_back(ConnectionManagerAccess::Connect(manager, NodeInfo(offered.back(), fob, true)));
+    io_service.reset();
+    io_service.poll();
+    ASSERT_LE(manager.Size(), kMaxPeers);
+    if (i == kMaxPeers)
+      descriptors_when_full = OpenFileDescriptors();
+  }
+
+  EXPECT_EQ(kMaxPeers, manager.Size());
+  EXPECT_LE(OpenFileDescriptors(), descriptors_when_full);
+  EXPECT_LE(SharedBufferPool().GetStats().bytes_in_use, manager.Size() * BufferPool::SizeClass(1048576));
+  size_t live_sockets(0);
+  for (size_t i(0); i < kPeerCount; ++i) {
+    EXPECT_EQ(manager.IsManaged(offered[i]), !sockets[i].expired());
+    if (!sockets[i].expired())
+      ++live_sockets;
+  }
+  EXPECT_EQ(manager.Size(), live_sockets);
+
+  // The peers kept are the closest which fit the routing table, so include our close group.
+  auto closest(SortedByDistanceFrom(manager.OurId(), offered));
+  closest.resize(GroupSize);
+  for (const auto& id : closest)
+    EXPECT_TRUE(manager.IsManaged(id));
+
+  // A peer already held isn't connected to again.
+  asio::error_code result;
+  manager.AddNode(NodeInfo(closest.front(), fob, true), EndpointPair(),
+                  [&](asio::error_code error) { result = error; });
+  io_service.reset();
+  io_service.poll();
+  EXPECT_EQ(asio::error_code(asio::error::connection_refused), result);
+
+  manager.Shutdown();
+  io_service.reset();
+  io_service.poll();
+  for (const auto& socket : sockets)
+    EXPECT_TRUE(socket.expired());
+}
+
+// Changes to our close group are reported precisely by 'DropNodes', and merged into one
+// notification per window.
+TEST(ConnectionManagerPeersTest, BEH_CloseGroupChange) {
+  asio::io_service io_service;
+  ConnectionManager manager(io_service, PublicFob());
+  std::vector<CloseGroupChange> notified;
+  manager.SetOnCloseGroupChanged(
+      [&](CloseGroupChange change) { notified.push_back(std::move(change)); },
+      std::chrono::milliseconds(20));
+  auto sorted_ids = [&](std::vector<Address> ids) {
+    return SortedByDistanceFrom(manager.OurId(), std::move(ids));
+  };
+
+  const auto fob(PublicFob());
+  std::vector<Address> offered;
+  for (int i(0); i < 100; ++i) {
+    offered.push_back(MakeIdentity());
+    ConnectionManagerAccess::Connect(manager, NodeInfo(offered.back(), fob, true));
+  }
+  // A single notification, with nodes which joined then left the group in the window cancelled.
+  io_service.run();
+  ASSERT_EQ(1U, notified.size());
+  auto group(sorted_ids(offered));
+  group.resize(GroupSize);
+  EXPECT_EQ(group, sorted_ids(notified.front().added));
+  EXPECT_TRUE(notified.front().removed.empty());
+
+  // Dropping peers outside the group changes nothing.
+  std::vector<Address> held;
+  for (const auto& id : offered) {
+    if (manager.IsManaged(id))
+      held.push_back(id);
+  }
+  held = sorted_ids(held);
+  EXPECT_FALSE(!!manager.DropNode(held.back()));
+
+  // Dropping three group members brings in the next three held.
+  std::vector<Address> batch{held[0], held[5], held[GroupSize - 1], MakeIdentity()};
+  auto change(manager.DropNodes(batch));
+  ASSERT_TRUE(!!change);
+  batch.pop_back();
+  EXPECT_EQ(batch, sorted_ids(change->removed));
+  EXPECT_EQ(std::vector<Address>(held.begin() + GroupSize, held.begin() + GroupSize + 3),
+            sorted_ids(change->added));
+
+  // Further churn in the same window is merged, cancelling out a node which leaves and returns.
+  change = manager.DropNode(held[1]);
+  ASSERT_TRUE(!!change);
+  ASSERT_EQ(1U, change->removed.size());
+  ConnectionManagerAccess::Connect(manager, NodeInfo(held[1], fob, true));
+  io_service.reset();
+  io_service.run();
+  ASSERT_EQ(2U, notified.size());
+  EXPECT_EQ(batch, sorted_ids(notified.back().removed));
+  EXPECT_EQ(std::vector<Address>(held.begin() + GroupSize, held.begin() + GroupSize + 3),
+            sorted_ids(notified.back().added));
+
+  // No notification follows shutdown.
+  manager.DropNode(held[2]);
+  manager.Shutdown();
+  io_service.reset();
+  io_service.run();
+  EXPECT_EQ(2U, notified.size());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,276 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/ip/udp.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/crux/acceptor.hpp"
+#include "maidsafe/crux/socket.hpp"
+
+#include "maidsafe/routing/io_shards.h"
+#include "maidsafe/routing/mpsc_queue.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// Blocks until 'Count' has been called 'target' times.
+class Latch {
+ public:
+  explicit Latch(size_t target) : mutex_(), condition_(), count_(0), target_(target) {}
+
+  void Count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (++count_ == target_)
+      condition_.notify_all();
+  }
+
+  bool Wait(std::chrono::steady_clock::duration timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return condition_.wait_for(lock, timeout, [this] { return count_ >= target_; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  size_t count_;
+  const size_t target_;
+};
+
+}  // unnamed namespace
+
+TEST(IoShardsTest, BEH_MpscQueue) {
+  const int kProducers(4), kPerProducer(20000);
+  MpscQueue<std::pair<int, int>> queue;
+  std::vector<std::thread> producers;
+  for (int producer(0); producer < kProducers; ++producer) {
+    producers.emplace_back([&queue, producer, kPerProducer] {
+      for (int i(0); i < kPerProducer; ++i)
+        queue.Push(std::make_pair(producer, i));
+    });
+  }
+
+  // Each producer's values arrive in the order pushed.
+  std::vector<int> next(kProducers, 0);
+  std::pair<int, int> value;
+  int popped(0);
+  while (popped < kProducers * kPerProducer) {
+    if (!queue.Pop(value)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(next[value.first], value.second);
+    ++next[value.first];
+    ++popped;
+  }
+  for (auto& producer : producers)
+    producer.join();
+  EXPECT_FALSE(queue.Pop(value));
+
+  // Values left in the queue are destroyed with it.
+  auto tracked(std::make_shared<int>(0));
+  {
+    MpscQueue<std::shared_ptr<int>> left;
+    left.Push(tracked);
+    left.Push(tracked);
+  }
+  EXPECT_TRUE(tracked.unique());
+}
+
+TEST(IoShardsTest, BEH_Post) {
+  const size_t kPosters(4), kPerPoster(5000);
+  IoShards shards(3);
+  ASSERT_EQ(3U, shards.Count());
+  EXPECT_EQ(&shards[0], &shards.Control());
+
+  // Tasks posted from several threads all run, on the shard's own thread, in the order each thread
+  // posted them.
+  for (size_t shard(0); shard < shards.Count(); ++shard) {
+    Latch done(kPosters * kPerPoster);
+    std::vector<size_t> next(kPosters, 0);
+    std::atomic<bool> in_order(true), on_shard(true);
+    std::vector<std::thread> posters;
+    for (size_t poster(0); poster < kPosters; ++poster) {
+      posters.emplace_back([&, poster] {
+        for (size_t i(0); i < kPerPoster; ++i) {
+          shards[shard].Post([&, poster, i] {
+            if (next[poster]++ != i)
+              in_order = false;
+            if (!shards[shard].RunningInThisThread())
+              on_shard = false;
+            done.Count();
+          });
+        }
+      });
+    }
+    for (auto& poster : posters)
+      poster.join();
+    ASSERT_TRUE(done.Wait(std::chrono::seconds(10)));
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(on_shard);
+    EXPECT_FALSE(shards[shard].RunningInThisThread());
+  }
+
+  // An object released to a shard is destroyed on its thread.
+  auto object(std::make_shared<int>(0));
+  std::weak_ptr<int> weak_object(object);
+  Latch released(1);
+  shards[1].Release(std::move(object));
+  shards[1].Post([&] { released.Count(); });
+  ASSERT_TRUE(released.Wait(std::chrono::seconds(10)));
+  EXPECT_TRUE(weak_object.expired());
+
+  // Peers' IDs are spread over all the shards.
+  std::vector<size_t> per_shard(shards.Count(), 0);
+  for (int i(0); i < 3000; ++i) {
+    Address id(MakeIdentity());
+    auto shard(shards.ShardOf(id));
+    ASSERT_LT(shard, shards.Count());
+    EXPECT_EQ(shard, shards.ShardOf(id));
+    ++per_shard[shard];
+  }
+  for (auto count : per_shard)
+    EXPECT_GT(count, 500U);
+
+  // Tasks still queued when the shards stop are discarded.
+  shards.Stop();
+  IoShards single(0);
+  EXPECT_EQ(1U, single.Count());
+}
+
+// Each shard runs a pair of crux sockets over loopback, one streaming messages to the other, and
+// the messages delivered per second are reported for increasing numbers of shards.
+TEST(IoShardsTest, FUNC_LoopbackThroughput) {
+  const size_t kMessagesPerPair(20000), kMessageSize(512), kWindow(32);
+  const unsigned short kBasePort(static_cast<unsigned short>(20000 + RandomUint32() % 20000));
+
+  struct Pair {
+    std::unique_ptr<crux::acceptor> acceptor;
+    std::shared_ptr<crux::socket> server, client;
+    std::array<byte, kMessageSize> receive_buffer;
+    std::vector<byte> message;
+    size_t sent, received;
+  };
+
+  size_t max_shards(std::max(IoShards::DefaultCount(), size_t{4}));
+  unsigned short port(kBasePort);
+  for (size_t shard_count(1); shard_count <= max_shards; shard_count *= 2) {
+    IoShards shards(shard_count);
+    std::vector<std::unique_ptr<Pair>> pairs;
+    Latch connected(shard_count * 2), finished(shard_count);
+
+    for (size_t i(0); i < shard_count; ++i) {
+      pairs.emplace_back(new Pair);
+      auto& pair(*pairs.back());
+      pair.message.assign(kMessageSize, static_cast<byte>(i));
+      pair.sent = pair.received = 0;
+      auto& shard(shards[i]);
+      crux::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port++);
+      shard.Post([&, endpoint] {
+        pair.acceptor.reset(new crux::acceptor(shard.service(), endpoint));
+        pair.server = std::make_shared<crux::socket>(shard.service());
+        pair.acceptor->async_accept(*pair.server, [&](boost::system::error_code error) {
+          ASSERT_FALSE(error);
+          connected.Count();
+        });
+        pair.client = std::make_shared<crux::socket>(
+            shard.service(), crux::endpoint(boost::asio::ip::udp::v4(), 0));
+        pair.client->async_connect(endpoint, [&](boost::system::error_code error) {
+          ASSERT_FALSE(error);
+          connected.Count();
+        });
+      });
+    }
+    ASSERT_TRUE(connected.Wait(std::chrono::seconds(10)));
+
+    auto start(std::chrono::steady_clock::now());
+    for (size_t i(0); i < shard_count; ++i) {
+      auto& pair(*pairs[i]);
+      // Keep up to 'kWindow' sends in flight, and receive until all have arrived.
+      std::shared_ptr<std::function<void()>> send(std::make_shared<std::function<void()>>());
+      std::weak_ptr<std::function<void()>> weak_send(send);
+      *send = [&pair, weak_send, kMessagesPerPair] {
+        if (pair.sent == kMessagesPerPair)
+          return;
+        ++pair.sent;
+        auto again(weak_send.lock());
+        pair.client->async_send(boost::asio::buffer(pair.message),
+                                [again](boost::system::error_code error, size_t) {
+          if (!error)
+            (*again)();
+        });
+      };
+      std::shared_ptr<std::function<void()>> receive(std::make_shared<std::function<void()>>());
+      std::weak_ptr<std::function<void()>> weak_receive(receive);
+      *receive = [&pair, &finished, weak_receive, kMessagesPerPair] {
+        auto again(weak_receive.lock());
+        pair.server->async_receive(boost::asio::buffer(pair.receive_buffer),
+                                   [&pair, &finished, again, kMessagesPerPair](
+                                       boost::system::error_code error, size_t) {
+          if (error)
+            return;
+          if (++pair.received == kMessagesPerPair)
+            return finished.Count();
+          (*again)();
+        });
+      };
+      shards[i].Post([send, receive, kWindow] {
+        (*receive)();
+        for (size_t j(0); j < kWindow; ++j)
+          (*send)();
+      });
+    }
+    ASSERT_TRUE(finished.Wait(std::chrono::minutes(2)));
+    std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - start);
+
+    std::cout << shard_count << " shards:  "
+              << static_cast<uint64_t>(kMessagesPerPair * shard_count / elapsed.count())
+              << " messages/s\n";
+    for (size_t i(0); i < shard_count; ++i) {
+      auto& pair(*pairs[i]);
+      shards[i].Post([&pair] {
+        pair.client.reset();
+        pair.server.reset();
+        pair.acceptor.reset();
+      });
+    }
+    shards.Stop();
+  }
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,133 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_buffers.h"
+
+#include "maidsafe/common/serialisation/binary_archive.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/compact_header.h"
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/messages/messages.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+SerialisedMessage Joined(const SharedBuffers& buffers) {
+  SerialisedMessage joined;
+  joined.reserve(BufferSize(buffers));
+  for (const auto& buffer : buffers)
+    joined.insert(joined.end(), buffer->begin(), buffer->end());
+  return joined;
+}
+
+// 'cereal' (a whole message with a cereal-encoded header) with the header in the compact encoding.
+SerialisedMessage WithCompactHeader(const MessageHeader& header, const SerialisedMessage& cereal) {
+  auto compact(SerialiseCompactHeader(header));
+  compact.insert(compact.end(), cereal.begin() + Serialise(header).size(), cereal.end());
+  return compact;
+}
+
+}  // anonymous namespace
+
+TEST(MessageBuffersTest, BEH_SerialiseBuffers) {
+  auto header(GetRandomMessageHeader());
+  GetData get_data(Data::NameAndTypeId{MakeIdentity(), DataTypeId{RandomUint32()}},
+                   SourceAddress(NodeAddress(MakeIdentity()), boost::none, boost::none));
+  auto buffers(SerialiseBuffers(header, MessageToTag<GetData>::value(), get_data));
+  EXPECT_EQ(2U, buffers.size());
+  EXPECT_EQ(Serialise(header, MessageToTag<GetData>::value(), get_data), Joined(buffers));
+}
+
+// The payload is sent as it is, rather than copied, and the message parses as a 'PutData'.
+TEST(MessageBuffersTest, BEH_PutDataBuffers) {
+  auto header(GetRandomMessageHeader());
+  DataTypeId type_id(RandomUint32());
+  auto data(MakeSharedMessage(RandomBytes(1000, 10000)));
+  for (auto tag : {MessageTypeTag::PutData, MessageTypeTag::Post}) {
+    auto buffers(PutDataBuffers(header, tag, type_id, data));
+    ASSERT_EQ(2U, buffers.size());
+    EXPECT_EQ(data, buffers.back());
+    EXPECT_EQ(Serialise(header, tag, PutData(type_id, *data)), Joined(buffers));
+
+    InputVectorStream binary_input_stream{Joined(buffers)};
+    MessageHeader parsed_header;
+    MessageTypeTag parsed_tag;
+    Parse(binary_input_stream, parsed_header, parsed_tag);
+    EXPECT_EQ(header, parsed_header);
+    EXPECT_EQ(tag, parsed_tag);
+    auto put_data(Parse<PutData>(binary_input_stream));
+    EXPECT_EQ(type_id, put_data.type_id());
+    EXPECT_EQ(*data, put_data.data());
+  }
+}
+
+TEST(MessageBuffersTest, BEH_GetDataResponseBuffers) {
+  auto header(GetRandomMessageHeader());
+  Data::NameAndTypeId name_and_type_id{MakeIdentity(), DataTypeId{RandomUint32()}};
+  auto data(MakeSharedMessage(RandomBytes(1000, 10000)));
+  auto buffers(GetDataResponseBuffers(header, name_and_type_id, data));
+  ASSERT_EQ(3U, buffers.size());
+  EXPECT_EQ(data, buffers[1]);
+  EXPECT_EQ(Serialise(header, MessageToTag<GetDataResponse>::value(),
+                      GetDataResponse(name_and_type_id, SerialisedData(*data))),
+            Joined(buffers));
+}
+
+// Each differs from the default only in the header's encoding, and still doesn't copy the data.
+TEST(MessageBuffersTest, BEH_CompactHeaderEncoding) {
+  auto header(GetRandomMessageHeader());
+  auto data(MakeSharedMessage(RandomBytes(1000, 10000)));
+
+  GetData get_data(Data::NameAndTypeId{MakeIdentity(), DataTypeId{RandomUint32()}},
+                   SourceAddress(NodeAddress(MakeIdentity()), boost::none, boost::none));
+  EXPECT_EQ(WithCompactHeader(header, Serialise(header, MessageTypeTag::GetData, get_data)),
+            Joined(SerialiseBuffers(header, MessageTypeTag::GetData, get_data,
+                                    HeaderEncoding::compact)));
+
+  DataTypeId type_id(RandomUint32());
+  auto put_buffers(
+      PutDataBuffers(header, MessageTypeTag::PutData, type_id, data, HeaderEncoding::compact));
+  EXPECT_EQ(data, put_buffers.back());
+  EXPECT_EQ(WithCompactHeader(header, Serialise(header, MessageTypeTag::PutData,
+                                                PutData(type_id, *data))),
+            Joined(put_buffers));
+
+  Data::NameAndTypeId name_and_type_id{MakeIdentity(), DataTypeId{RandomUint32()}};
+  auto response_buffers(
+      GetDataResponseBuffers(header, name_and_type_id, data, HeaderEncoding::compact));
+  EXPECT_EQ(data, response_buffers[1]);
+  EXPECT_EQ(WithCompactHeader(header, Serialise(header, MessageTypeTag::GetDataResponse,
+                                                GetDataResponse(name_and_type_id,
+                                                                SerialisedData(*data)))),
+            Joined(response_buffers));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
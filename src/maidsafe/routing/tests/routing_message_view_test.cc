@@ -0,0 +1,110 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_view.h"
+
+#include <vector>
+
+#include "maidsafe/common/serialisation/serialisation.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/messages/messages.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// Headers with each combination of the optional addresses and signature.
+std::vector<MessageHeader> Headers() {
+  std::vector<MessageHeader> headers;
+  auto signature(asymm::Sign(asymm::PlainText(RandomString(identity_size)),
+                             asymm::GenerateKeyPair().private_key));
+  for (int i(0); i < 8; ++i) {
+    DestinationAddress destination(Destination(MakeIdentity()), boost::none);
+    if (i & 1)
+      destination.second = ReplyToAddress(MakeIdentity());
+    SourceAddress source(NodeAddress(MakeIdentity()), boost::none, boost::none);
+    if (i & 2)
+      source.group_address = GroupAddress(MakeIdentity());
+    else if (i & 4)
+      source.reply_to_address = ReplyToAddress(MakeIdentity());
+    if (i & 4) {
+      headers.emplace_back(destination, source, MessageId(RandomUint32()), Authority::nae_manager,
+                           signature);
+    } else {
+      headers.emplace_back(destination, source, MessageId(RandomUint32()), Authority::client);
+    }
+  }
+  return headers;
+}
+
+}  // anonymous namespace
+
+TEST(MessageViewTest, BEH_ReadsRoutingFields) {
+  for (auto& header : Headers()) {
+    PutData body(DataTypeId(RandomUint32()), RandomBytes(1, 1000));
+    MessageView view(MakeSharedMessage(Serialise(header, MessageTypeTag::PutData, body)));
+    EXPECT_EQ(header.Destination().first, view.Destination());
+    EXPECT_EQ(header.FromNode(), view.FromNode());
+    EXPECT_EQ(header.MessageId(), view.MessageId());
+    EXPECT_EQ(header.RelayedMessage(), view.RelayedMessage());
+    EXPECT_EQ(header.ReplyToAddress(), view.ReplyToAddress());
+    EXPECT_EQ(header.FilterValue(), view.FilterValue());
+    EXPECT_EQ(MessageTypeTag::PutData, view.Tag());
+
+    EXPECT_EQ(header, view.Header());
+    auto parsed(view.ParseBody<PutData>());
+    EXPECT_EQ(body.type_id(), parsed.type_id());
+    EXPECT_EQ(body.data(), parsed.data());
+    // the body can only be parsed once
+    EXPECT_THROW(view.ParseBody<PutData>(), common_error);
+  }
+}
+
+TEST(MessageViewTest, BEH_ParseBodyWithoutHeader) {
+  auto header(GetRandomMessageHeader());
+  FindGroup body(NodeAddress(MakeIdentity()), MakeIdentity());
+  MessageView view(MakeSharedMessage(Serialise(header, MessageTypeTag::FindGroup, body)));
+  auto parsed(view.ParseBody<FindGroup>());
+  EXPECT_EQ(body.requester_id(), parsed.requester_id());
+  EXPECT_EQ(body.target_id(), parsed.target_id());
+  EXPECT_EQ(header, view.Header());
+}
+
+TEST(MessageViewTest, BEH_RejectsTruncatedHeaders) {
+  auto header(GetRandomMessageHeader());
+  auto serialised(Serialise(header, MessageTypeTag::Connect));
+  EXPECT_NO_THROW(MessageView{MakeSharedMessage(serialised)});
+  for (size_t size(0); size < serialised.size(); ++size) {
+    SerialisedMessage truncated(serialised.begin(), serialised.begin() + size);
+    EXPECT_THROW(MessageView{MakeSharedMessage(truncated)}, common_error) << size;
+  }
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,127 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/accumulator.h"
+#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+struct SmallNetworkParameters {
+  static const size_t GroupSize = 4;
+  static const size_t QuorumSize = 3;
+  static const size_t BucketSize = 1;
+  static const size_t Parallelism = 2;
+  static const size_t OptimalSize = 8;
+  static const size_t ReplacementCacheSize = 2;
+};
+
+using SmallRoutingTable = BasicRoutingTable<SmallNetworkParameters>;
+
+std::vector<Address> Ids(const std::vector<NodeInfo>& nodes) {
+  std::vector<Address> ids;
+  for (const auto& node : nodes)
+    ids.push_back(node.id);
+  return ids;
+}
+
+// Returns a contact held by 'table' which isn't in its close group.
+template <typename Table>
+Address NonCloseGroupContact(const Table& table, const std::vector<NodeInfo>& nodes) {
+  auto group(Ids(table.OurCloseGroup()));
+  for (const auto& node : nodes) {
+    if (table.GetPublicKey(node.id) &&
+        std::find(std::begin(group), std::end(group), node.id) == std::end(group))
+      return node.id;
+  }
+  return Address();
+}
+
+}  // unnamed namespace
+
+TEST(NetworkParametersTest, BEH_RoutingTablesSideBySide) {
+  auto our_id(MakeIdentity());
+  RoutingTable table(our_id);
+  SmallRoutingTable small_table(our_id);
+  EXPECT_EQ(GroupSize, RoutingTable::GroupSize());
+  EXPECT_EQ(4U, SmallRoutingTable::GroupSize());
+  EXPECT_EQ(2U, SmallRoutingTable::Parallelism());
+  EXPECT_EQ(8U, SmallRoutingTable::OptimalSize());
+
+  auto fob(PublicFob());
+  std::vector<NodeInfo> nodes;
+  for (int i(0); i < 500; ++i)
+    nodes.emplace_back(MakeIdentity(), fob, true);
+  table.AddNodes(nodes);
+  small_table.AddNodes(nodes);
+
+  // each table fills to its own size and keeps its own close group, which is the closest
+  // 'GroupSize()' of all the contacts offered
+  EXPECT_GE(table.Size(), RoutingTable::OptimalSize());
+  EXPECT_GE(small_table.Size(), SmallRoutingTable::OptimalSize());
+  EXPECT_LT(small_table.Size(), table.Size());
+  auto group(Ids(table.OurCloseGroup()));
+  auto small_group(Ids(small_table.OurCloseGroup()));
+  ASSERT_EQ(GroupSize, group.size());
+  ASSERT_EQ(SmallRoutingTable::GroupSize(), small_group.size());
+  EXPECT_TRUE(std::equal(std::begin(small_group), std::end(small_group), std::begin(group)));
+
+  // a target in the close group gets the whole close group, any other the 'Parallelism()' closest
+  EXPECT_EQ(GroupSize, table.TargetNodes(group.back()).size());
+  EXPECT_EQ(SmallRoutingTable::GroupSize(), small_table.TargetNodes(small_group.back()).size());
+  auto target(NonCloseGroupContact(table, nodes));
+  ASSERT_TRUE(target.IsInitialised());
+  auto targets(table.TargetNodes(target));
+  ASSERT_EQ(RoutingTable::Parallelism(), targets.size());
+  EXPECT_EQ(target, targets.front().id);
+  auto small_target(NonCloseGroupContact(small_table, nodes));
+  ASSERT_TRUE(small_target.IsInitialised());
+  auto small_targets(small_table.TargetNodes(small_target));
+  ASSERT_EQ(SmallRoutingTable::Parallelism(), small_targets.size());
+  EXPECT_EQ(small_target, small_targets.front().id);
+}
+
+TEST(NetworkParametersTest, BEH_AccumulatorQuorum) {
+  Accumulator<int, int> accumulator(std::chrono::minutes(1));
+  Accumulator<int, int, SmallNetworkParameters> small_accumulator(std::chrono::minutes(1));
+  for (size_t i(1); i <= QuorumSize; ++i) {
+    auto sender(MakeIdentity());
+    EXPECT_EQ(i >= QuorumSize, accumulator.Add(0, 0, sender).is_initialized());
+    EXPECT_EQ(i >= SmallNetworkParameters::QuorumSize,
+              small_accumulator.Add(0, 0, sender).is_initialized());
+  }
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
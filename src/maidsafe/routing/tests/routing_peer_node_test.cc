@@ -0,0 +1,338 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "asio/io_service.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/crux/acceptor.hpp"
+#include "maidsafe/crux/socket.hpp"
+
+#include "maidsafe/routing/batch_frame.h"
+#include "maidsafe/routing/buffer_pool.h"
+#include "maidsafe/routing/peer_node.h"
+#include "maidsafe/routing/types.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+class PeerNodeTest : public testing::Test {
+ protected:
+  PeerNodeTest() : ios_(), sender_(), receiver_() {}
+
+  // Connects two PeerNodes over loopback, 'sender_' and 'receiver_'.
+  void Connect(unsigned short port) {
+    crux::acceptor acceptor(ios_, crux::endpoint(boost::asio::ip::udp::v4(), port));
+    auto accepted_socket = std::make_shared<crux::socket>(ios_);
+    auto connecting_socket =
+        std::make_shared<crux::socket>(ios_, crux::endpoint(boost::asio::ip::udp::v4(), 0));
+
+    acceptor.async_accept(*accepted_socket, [&](boost::system::error_code error) {
+      ASSERT_FALSE(error);
+      receiver_.reset(new PeerNode(NodeInfo(MakeIdentity(), PublicFob(), true), accepted_socket));
+    });
+
+    connecting_socket->async_connect(
+        crux::endpoint(boost::asio::ip::address_v4::loopback(), port),
+        [&](boost::system::error_code error) {
+          ASSERT_FALSE(error);
+          sender_.reset(new PeerNode(NodeInfo(MakeIdentity(), PublicFob(), true),
+                                     connecting_socket));
+        });
+
+    ios_.run();
+    ios_.reset();
+    ASSERT_TRUE(sender_ && receiver_);
+  }
+
+  boost::asio::io_service ios_;
+  std::unique_ptr<PeerNode> sender_, receiver_;
+};
+
+// Measures how many bytes are handed to the receive handler per message.  Before the receive
+// buffer was trimmed, every message delivered the whole 'MaxMessageSize()' buffer (which
+// 'MessageReceived' then copied again), regardless of the size actually received.
+TEST_F(PeerNodeTest, FUNC_ReceiveDeliversExactSize) {
+  Connect(8090);
+
+  const std::vector<size_t> message_sizes{64, 512, 4096, 65536};
+  const int messages_per_size(100);
+
+  for (auto message_size : message_sizes) {
+    SerialisedMessage message(message_size);
+    for (auto& byte_value : message)
+      byte_value = static_cast<byte>(RandomUint32());
+
+    const auto pooled_bytes_in_use(SharedBufferPool().GetStats().bytes_in_use);
+    std::uint64_t bytes_delivered(0);
+    int received(0);
+    std::function<void(asio::error_code, SerialisedMessage)> on_receive =
+        [&](asio::error_code error, SerialisedMessage bytes) {
+          ASSERT_FALSE(error);
+          EXPECT_EQ(message, bytes);
+          // the receive buffer has gone back to the pool
+          EXPECT_EQ(pooled_bytes_in_use, SharedBufferPool().GetStats().bytes_in_use);
+          bytes_delivered += bytes.size();
+          if (++received < messages_per_size)
+            receiver_->Receive(on_receive);
+        };
+    receiver_->Receive(on_receive);
+
+    auto start(std::chrono::steady_clock::now());
+    for (int i(0); i < messages_per_size; ++i)
+      sender_->Send(message, [](asio::error_code error) { ASSERT_FALSE(error); });
+    ios_.run();
+    ios_.reset();
+    auto elapsed(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start));
+
+    ASSERT_EQ(messages_per_size, received);
+    EXPECT_EQ(message_size * messages_per_size, bytes_delivered);
+    std::cout << "Message size " << message_size << " bytes:  handed to receiver per message "
+              << bytes_delivered / messages_per_size << " bytes (previously "
+              << PeerNode::MaxMessageSize() << " bytes), " << elapsed.count() / messages_per_size
+              << " us per message\n";
+  }
+}
+
+// Compares loopback throughput of small messages with and without batching.  Each batch frame is
+// unpacked by the receiver, as 'ConnectionManager' does.
+TEST_F(PeerNodeTest, FUNC_BatchingThroughput) {
+  Connect(8091);
+
+  const size_t message_count(20000), message_size(100);
+  sender_->SetSendQueueHighWaterMark(message_count);
+  SerialisedMessage message(message_size);
+  for (auto& byte_value : message)
+    byte_value = static_cast<byte>(RandomUint32());
+  auto shared_message(MakeSharedMessage(message));
+
+  for (bool batching : {false, true}) {
+    if (batching)
+      sender_->EnableBatching(PeerNode::DefaultBatchingOptions());
+    else
+      sender_->DisableBatching();
+    const auto transmissions_before(sender_->GetSendQueueStats().transmissions);
+
+    size_t received(0), packets(0);
+    std::function<void(asio::error_code, SerialisedMessage)> on_receive =
+        [&](asio::error_code error, SerialisedMessage bytes) {
+          ASSERT_FALSE(error);
+          ++packets;
+          if (IsBatchFrame(bytes)) {
+            for (const auto& unpacked : ParseBatchFrame(bytes))
+              EXPECT_EQ(message, unpacked);
+            received += ParseBatchFrame(bytes).size();
+          } else {
+            EXPECT_EQ(message, bytes);
+            ++received;
+          }
+          if (received < message_count)
+            receiver_->Receive(on_receive);
+        };
+    receiver_->Receive(on_receive);
+
+    auto start(std::chrono::steady_clock::now());
+    for (size_t i(0); i < message_count; ++i) {
+      sender_->Send(shared_message, SendPolicy::reject,
+                    [](asio::error_code error) { ASSERT_FALSE(error); });
+    }
+    ios_.run();
+    ios_.reset();
+    auto seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    ASSERT_EQ(message_count, received);
+    EXPECT_EQ(packets, sender_->GetSendQueueStats().transmissions - transmissions_before);
+    if (batching)
+      EXPECT_LT(packets, message_count);
+    else
+      EXPECT_EQ(message_count, packets);
+    std::cout << "Batching " << (batching ? "on: " : "off:") << "  " << message_count / seconds
+              << " messages/s, " << packets / seconds << " packets/s, "
+              << static_cast<double>(message_count) / packets << " messages per packet\n";
+  }
+}
+
+// The send queue delivers in order with one send in flight, and applies the high-water mark by
+// policy.  The socket isn't connected, so the sends themselves may fail, but they still complete.
+TEST(PeerNodeSendQueueTest, BEH_OrderAndHighWaterMark) {
+  boost::asio::io_service ios;
+  PeerNode peer(NodeInfo(MakeIdentity(), PublicFob(), true), std::make_shared<crux::socket>(ios));
+  EXPECT_EQ(PeerNode::DefaultSendQueueHighWaterMark(), peer.SendQueueHighWaterMark());
+  peer.SetSendQueueHighWaterMark(4);
+
+  std::vector<int> completed;
+  std::vector<std::pair<int, asio::error_code>> failed;
+  auto send = [&](int index, SendPolicy policy) {
+    peer.Send(MakeSharedMessage(SerialisedMessage(10 * (index + 1))), policy,
+              [&, index](asio::error_code error) {
+      if (error == asio::error::no_buffer_space || error == asio::error::operation_aborted)
+        failed.emplace_back(index, error);
+      else
+        completed.push_back(index);
+    });
+  };
+
+  send(0, SendPolicy::reject);
+  send(1, SendPolicy::drop_oldest);
+  send(2, SendPolicy::reject);
+  send(3, SendPolicy::drop_oldest);
+  auto stats(peer.GetSendQueueStats());
+  EXPECT_EQ(4U, stats.depth);
+  EXPECT_EQ(100U, stats.bytes);
+
+  // The queue is full: a 'reject' message is refused, and a 'drop_oldest' one displaces the oldest
+  // other 'drop_oldest' message.  Their handlers are posted rather than invoked from 'Send'.
+  send(4, SendPolicy::reject);
+  send(5, SendPolicy::drop_oldest);
+  EXPECT_TRUE(failed.empty());
+  stats = peer.GetSendQueueStats();
+  EXPECT_EQ(4U, stats.depth);
+  EXPECT_EQ(10U + 30U + 40U + 60U, stats.bytes);
+  EXPECT_EQ(1U, stats.rejected);
+  EXPECT_EQ(1U, stats.dropped);
+  EXPECT_EQ(0U, stats.sent);
+
+  // Only the first message has been handed to the socket; the rest follow in order.
+  ios.poll_one();
+  EXPECT_EQ(std::vector<int>{0}, completed);
+  ios.run();
+  EXPECT_EQ((std::vector<int>{0, 2, 3, 5}), completed);
+  EXPECT_EQ((std::vector<std::pair<int, asio::error_code>>{
+                std::make_pair(4, asio::error_code(asio::error::no_buffer_space)),
+                std::make_pair(1, asio::error_code(asio::error::operation_aborted))}),
+            failed);
+  stats = peer.GetSendQueueStats();
+  EXPECT_EQ(0U, stats.depth);
+  EXPECT_EQ(0U, stats.bytes);
+  EXPECT_EQ(4U, stats.sent);
+  EXPECT_GE(stats.total_time_in_queue, stats.max_time_in_queue);
+  EXPECT_EQ(std::chrono::steady_clock::duration::zero(), stats.oldest_time_in_queue);
+
+  // With no droppable messages queued, a 'drop_oldest' message is refused too.
+  for (int i(0); i < 4; ++i)
+    send(6 + i, SendPolicy::reject);
+  send(10, SendPolicy::drop_oldest);
+  EXPECT_GE(peer.GetSendQueueStats().oldest_time_in_queue,
+            std::chrono::steady_clock::duration::zero());
+  ios.reset();
+  ios.run();
+  ASSERT_EQ(3U, failed.size());
+  EXPECT_EQ(std::make_pair(10, asio::error_code(asio::error::no_buffer_space)), failed.back());
+}
+
+// A message given as several buffers is queued and sent as one message.
+TEST(PeerNodeSendQueueTest, BEH_SendBuffers) {
+  boost::asio::io_service ios;
+  PeerNode peer(NodeInfo(MakeIdentity(), PublicFob(), true), std::make_shared<crux::socket>(ios));
+  auto body(MakeSharedMessage(SerialisedMessage(100000)));
+  int completed(0);
+  for (int i(0); i < 2; ++i) {
+    peer.Send(SharedBuffers{MakeSharedMessage(SerialisedMessage(50)), body},
+              [&](asio::error_code) { ++completed; });
+  }
+  EXPECT_EQ(2U * 100050U, peer.GetSendQueueStats().bytes);
+  ios.run();
+  EXPECT_EQ(2, completed);
+  auto stats(peer.GetSendQueueStats());
+  EXPECT_EQ(2U, stats.sent);
+  EXPECT_EQ(2U, stats.transmissions);
+  EXPECT_EQ(0U, stats.bytes);
+  // The body was shared by both messages, and is released once they're sent.
+  EXPECT_EQ(1, body.use_count());
+}
+
+// Small messages queued within the flush window go out together, in order, and a message too big
+// to batch closes the batch.  The socket isn't connected, so the sends may fail, but they complete.
+TEST(PeerNodeSendQueueTest, BEH_Batching) {
+  boost::asio::io_service ios;
+  PeerNode peer(NodeInfo(MakeIdentity(), PublicFob(), true), std::make_shared<crux::socket>(ios));
+  auto options(PeerNode::DefaultBatchingOptions());
+  options.flush_window = std::chrono::seconds(1);
+  peer.EnableBatching(options);
+
+  std::vector<int> completed;
+  auto send = [&](int index, size_t size) {
+    peer.Send(MakeSharedMessage(SerialisedMessage(size)), SendPolicy::reject,
+              [&, index](asio::error_code) { completed.push_back(index); });
+  };
+
+  // Ten small messages wait for the flush window, until a big one completes their batch.
+  for (int i(0); i < 10; ++i)
+    send(i, 100);
+  EXPECT_EQ(0U, peer.GetSendQueueStats().transmissions);
+  send(10, options.max_message_size + 1);
+  // More small messages than fit in a frame are split across two sends, the last closed by another
+  // big message.
+  const int frame_capacity(static_cast<int>((options.max_frame_size - BatchFrameOverhead(0)) /
+                                            (options.max_message_size + BatchFrameOverhead(1) -
+                                             BatchFrameOverhead(0))));
+  for (int i(0); i < frame_capacity + 1; ++i)
+    send(11 + i, options.max_message_size);
+  const int total(13 + frame_capacity);
+  send(total - 1, options.max_message_size + 1);
+  ios.run();
+  ios.reset();
+
+  ASSERT_EQ(static_cast<size_t>(total), completed.size());
+  for (int i(0); i < total; ++i)
+    EXPECT_EQ(i, completed[i]);
+  auto stats(peer.GetSendQueueStats());
+  EXPECT_EQ(5U, stats.transmissions);
+  EXPECT_EQ(static_cast<uint64_t>(total), stats.sent);
+  EXPECT_EQ(0U, stats.depth);
+
+  // Without a flush window, whatever is queued behind a send in progress is batched.
+  options.flush_window = std::chrono::steady_clock::duration::zero();
+  peer.EnableBatching(options);
+  completed.clear();
+  for (int i(0); i < 5; ++i)
+    send(i, 1);
+  ios.run();
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), completed);
+  EXPECT_EQ(7U, peer.GetSendQueueStats().transmissions);
+
+  // Small messages queued behind a send in progress don't wait for the flush window once it
+  // completes.
+  options.flush_window = std::chrono::seconds(1);
+  peer.EnableBatching(options);
+  completed.clear();
+  send(0, options.max_message_size + 1);
+  for (int i(1); i < 4; ++i)
+    send(i, 1);
+  ios.reset();
+  ios.poll();
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), completed);
+  EXPECT_EQ(9U, peer.GetSendQueueStats().transmissions);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
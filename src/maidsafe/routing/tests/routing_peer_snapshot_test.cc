@@ -0,0 +1,123 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <vector>
+
+#include "asio/ip/udp.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/peer_snapshot.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+PeerSnapshot MakeSnapshot(size_t size) {
+  PeerSnapshot peers;
+  for (size_t i(0); i < size; ++i) {
+    auto fob(PublicFob());
+    Address id(fob.Name());
+    auto port(static_cast<unsigned short>(5483 + i));
+    auto local(i % 2 == 0 ? address(address_v4::loopback()) : address(address_v6::loopback()));
+    peers.push_back(PeerSnapshotEntry{
+        NodeInfo(std::move(id), std::move(fob), true),
+        EndpointPair(asio::ip::udp::endpoint(local, port),
+                     asio::ip::udp::endpoint(address_v4::from_string("203.0.113.7"), port)),
+        std::chrono::system_clock::now() - std::chrono::seconds(i)});
+  }
+  return peers;
+}
+
+void ExpectEqual(const PeerSnapshot& expected, const PeerSnapshot& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i(0); i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].node_info.id, actual[i].node_info.id);
+    EXPECT_EQ(expected[i].node_info.id, Address(actual[i].node_info.dht_fob.Name()));
+    EXPECT_FALSE(actual[i].node_info.connected);
+    EXPECT_EQ(expected[i].endpoint_pair, actual[i].endpoint_pair);
+    EXPECT_EQ(std::chrono::duration_cast<std::chrono::milliseconds>(
+                  expected[i].last_seen.time_since_epoch()),
+              actual[i].last_seen.time_since_epoch());
+  }
+}
+
+}  // unnamed namespace
+
+TEST(PeerSnapshotTest, BEH_SerialiseAndParse) {
+  auto peers(MakeSnapshot(30));
+  auto bytes(SerialisePeerSnapshot(peers));
+  ExpectEqual(peers, ParsePeerSnapshot(bytes.data(), bytes.size()));
+
+  auto empty(SerialisePeerSnapshot(PeerSnapshot()));
+  EXPECT_TRUE(ParsePeerSnapshot(empty.data(), empty.size()).empty());
+}
+
+TEST(PeerSnapshotTest, BEH_RejectCorruptSnapshot) {
+  auto bytes(SerialisePeerSnapshot(MakeSnapshot(4)));
+
+  // Truncated anywhere, whether in the header, the records or the fobs.
+  for (auto size : {size_t{0}, size_t{10}, size_t{100}, bytes.size() - 1})
+    EXPECT_THROW(ParsePeerSnapshot(bytes.data(), size), common_error);
+
+  auto bad_magic(bytes);
+  bad_magic[0] ^= 0xff;
+  EXPECT_THROW(ParsePeerSnapshot(bad_magic.data(), bad_magic.size()), common_error);
+
+  auto bad_version(bytes);
+  ++bad_version[8];
+  EXPECT_THROW(ParsePeerSnapshot(bad_version.data(), bad_version.size()), common_error);
+
+  // A record whose ID doesn't match its fob.
+  auto bad_id(bytes);
+  bad_id[24] ^= 0xff;
+  EXPECT_THROW(ParsePeerSnapshot(bad_id.data(), bad_id.size()), common_error);
+}
+
+TEST(PeerSnapshotTest, BEH_WriteAndRead) {
+  auto test_path(maidsafe::test::CreateTestPath("MaidSafe_TestPeerSnapshot"));
+  auto path(*test_path / "peers.snapshot");
+
+  EXPECT_TRUE(ReadPeerSnapshot(path).empty());
+
+  auto peers(MakeSnapshot(10));
+  WritePeerSnapshot(path, peers);
+  ExpectEqual(peers, ReadPeerSnapshot(path));
+
+  // A rewrite replaces the previous snapshot entirely.
+  peers = MakeSnapshot(3);
+  WritePeerSnapshot(path, peers);
+  ExpectEqual(peers, ReadPeerSnapshot(path));
+  EXPECT_FALSE(boost::filesystem::exists(path.string() + ".new"));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,114 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/routing_table.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+std::vector<Address> Ids(const std::vector<NodeInfo>& nodes) {
+  std::vector<Address> ids;
+  for (const auto& node : nodes)
+    ids.push_back(node.id);
+  return ids;
+}
+
+}  // unnamed namespace
+
+TEST(RoutingTableAddDropNodesTest, BEH_MatchesSingleCalls) {
+  auto our_id(MakeIdentity());
+  RoutingTable batch_table(our_id), single_table(our_id);
+  auto fob(PublicFob());
+
+  for (int round(0); round < 5; ++round) {
+    std::vector<NodeInfo> nodes;
+    for (int i(0); i < 200; ++i)
+      nodes.emplace_back(MakeIdentity(), fob, true);
+    // include some duplicates and ourself, which should be ignored
+    nodes.push_back(nodes.front());
+    nodes.emplace_back(our_id, fob, true);
+
+    auto group_before(Ids(single_table.OurCloseGroup()));
+    std::vector<Address> added;
+    for (const auto& node : nodes) {
+      if (single_table.AddNode(node).first)
+        added.push_back(node.id);
+    }
+    auto result(batch_table.AddNodes(nodes));
+
+    ASSERT_EQ(single_table.Size(), batch_table.Size());
+    EXPECT_EQ(Ids(single_table.OurCloseGroup()), Ids(batch_table.OurCloseGroup()));
+    for (const auto& node : nodes)
+      EXPECT_EQ(single_table.GetPublicKey(node.id).is_initialized(),
+                batch_table.GetPublicKey(node.id).is_initialized());
+
+    // 'added' only holds contacts still in the table, 'dropped' only ones which were there before
+    for (const auto& id : result.added) {
+      EXPECT_TRUE(batch_table.GetPublicKey(id).is_initialized());
+      EXPECT_NE(std::end(added), std::find(std::begin(added), std::end(added), id));
+    }
+    for (const auto& node : result.dropped)
+      EXPECT_FALSE(batch_table.GetPublicKey(node.id).is_initialized());
+
+    auto group_after(Ids(batch_table.OurCloseGroup()));
+    if (group_after == group_before) {
+      EXPECT_FALSE(result.close_group_change);
+    } else {
+      ASSERT_TRUE(result.close_group_change);
+      EXPECT_EQ(group_after, result.close_group_change->first);
+      EXPECT_EQ(group_before, result.close_group_change->second);
+    }
+  }
+
+  // drop the close group and some contacts not held, in a single batch
+  auto group(Ids(batch_table.OurCloseGroup()));
+  auto to_drop(group);
+  to_drop.push_back(MakeIdentity());
+  to_drop.push_back(our_id);
+  auto change(batch_table.DropNodes(to_drop).close_group_change);
+  for (const auto& id : to_drop)
+    single_table.DropNode(id);
+  EXPECT_EQ(single_table.Size(), batch_table.Size());
+  EXPECT_EQ(Ids(single_table.OurCloseGroup()), Ids(batch_table.OurCloseGroup()));
+  ASSERT_TRUE(change);
+  EXPECT_EQ(Ids(batch_table.OurCloseGroup()), change->first);
+  EXPECT_EQ(group, change->second);
+
+  // dropping contacts not held changes nothing
+  EXPECT_FALSE(batch_table.DropNodes(group).close_group_change);
+  EXPECT_FALSE(batch_table.DropNodes(std::vector<Address>()).close_group_change);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,483 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#if defined(MAIDSAFE_LINUX)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/types.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
+
+namespace {
+
+std::atomic<size_t> allocation_count(0);
+
+}  // unnamed namespace
+
+// Counts every heap allocation made by this test executable.
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  if (void* memory = std::malloc(size == 0 ? 1 : size))
+    return memory;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) MAIDSAFE_NOEXCEPT { std::free(memory); }
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+template <typename Function>
+double MicrosecondsPerCall(size_t calls, Function function) {
+  auto start(std::chrono::steady_clock::now());
+  function();
+  auto elapsed(std::chrono::steady_clock::now() - start);
+  return std::chrono::duration<double, std::micro>(elapsed).count() / calls;
+}
+
+// Counts L1 data cache read misses in this thread (user space only) via the Linux perf events
+// interface.  Where that's unavailable (other platforms, or no access to the hardware counters),
+// 'Available()' is false and the counts are always 0.
+class CacheMissCounter {
+ public:
+#if defined(MAIDSAFE_LINUX)
+  CacheMissCounter() : fd_(-1) {
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HW_CACHE;
+    attributes.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+  }
+  ~CacheMissCounter() {
+    if (fd_ != -1)
+      close(fd_);
+  }
+  bool Available() const { return fd_ != -1; }
+  template <typename Function>
+  uint64_t Count(Function function) {
+    if (fd_ == -1) {
+      function();
+      return 0;
+    }
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    function();
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t count(0);
+    return read(fd_, &count, sizeof(count)) == sizeof(count) ? count : 0;
+  }
+
+ private:
+  int fd_;
+#else
+  bool Available() const { return false; }
+  template <typename Function>
+  uint64_t Count(Function function) {
+    function();
+    return 0;
+  }
+#endif
+};
+
+std::vector<NodeInfo> MakeNodes(size_t count) {
+  auto fob(PublicFob());
+  std::vector<NodeInfo> nodes;
+  nodes.reserve(count);
+  for (size_t i(0); i < count; ++i)
+    nodes.emplace_back(MakeIdentity(), fob, true);
+  return nodes;
+}
+
+// The default parameters, but with a table of up to 'kOptimalSize' contacts.
+template <size_t kOptimalSize>
+struct SizedNetworkParameters : DefaultNetworkParameters {
+  static const size_t OptimalSize = kOptimalSize;
+};
+
+// Streams a network of 'network_size' contacts through a table, timing each of 'AddNode',
+// 'CheckNode' and 'DropNode' per call.
+template <typename Table>
+void AddCheckDrop(size_t network_size) {
+  Table table(MakeIdentity());
+  auto nodes(MakeNodes(network_size));
+
+  auto add_time(MicrosecondsPerCall(nodes.size(), [&] {
+    for (const auto& node : nodes)
+      table.AddNode(node);
+  }));
+  auto table_size(table.Size());
+  auto check_time(MicrosecondsPerCall(nodes.size(), [&] {
+    for (const auto& node : nodes)
+      table.CheckNode(node.id);
+  }));
+  auto drop_time(MicrosecondsPerCall(nodes.size(), [&] {
+    for (const auto& node : nodes)
+      table.DropNode(node.id);
+  }));
+  EXPECT_EQ(0U, table.Size());
+
+  std::cout << "Network of " << network_size << " (table size " << table_size
+            << "):  AddNode " << add_time << " us,  CheckNode " << check_time
+            << " us,  DropNode " << drop_time << " us\n";
+}
+
+}  // unnamed namespace
+
+// Varies the network size with the default table, which holds only 'OptimalSize()' (64) of it.
+// The per-call times fall as the network grows because most of a large network's contacts are
+// refused by 'AddNode' and unknown to 'DropNode', neither of which modifies the table.  In a
+// network no bigger than the table, every call modifies it, so publishes a new snapshot (a copy
+// of the changed bucket and of the list of bucket pointers) for lock-free readers; that is the
+// cost which a table read under a lock didn't pay.
+TEST(RoutingTableBenchmarkTest, FUNC_AddCheckDrop) {
+  for (auto network_size : {64, 256, 1024, 10000})
+    AddCheckDrop<RoutingTable>(network_size);
+}
+
+// Varies the table size itself, streaming through each a network four times its size.
+TEST(RoutingTableBenchmarkTest, FUNC_AddCheckDropTableSizes) {
+  AddCheckDrop<BasicRoutingTable<SizedNetworkParameters<64>>>(256);
+  AddCheckDrop<BasicRoutingTable<SizedNetworkParameters<256>>>(1024);
+  AddCheckDrop<BasicRoutingTable<SizedNetworkParameters<1024>>>(4096);
+  AddCheckDrop<BasicRoutingTable<SizedNetworkParameters<10000>>>(40000);
+}
+
+// Offers a stream of random candidates to a full table of 'OptimalSize()' contacts, reporting the
+// throughput of 'CheckNode', i.e. of deciding whether each would be worth adding.
+TEST(RoutingTableBenchmarkTest, FUNC_CheckNodeFullTable) {
+  const size_t kCalls(1000000);
+  RoutingTable table(MakeIdentity());
+  for (const auto& node : MakeNodes(RoutingTable::OptimalSize()))
+    table.AddNode(node);
+  ASSERT_EQ(RoutingTable::OptimalSize(), table.Size());
+  std::vector<Address> candidates;
+  for (int i(0); i < 10000; ++i)
+    candidates.push_back(MakeIdentity());
+
+  size_t accepted(0);
+  auto check_time(MicrosecondsPerCall(kCalls, [&] {
+    for (size_t i(0); i < kCalls; ++i)
+      accepted += table.CheckNode(candidates[i % candidates.size()]) ? 1 : 0;
+  }));
+  EXPECT_EQ(RoutingTable::OptimalSize(), table.Size());
+
+  std::cout << "CheckNode on a full table of " << table.Size() << ":  " << check_time << " us, "
+            << static_cast<size_t>(1.0 / check_time * 1e6) << " calls/s, "
+            << accepted * 100.0 / kCalls << "% of candidates accepted\n";
+}
+
+// Simulates the floods of 'FindGroupResponse' seen while bootstrapping, where almost every contact
+// offered to the table is already held.  Each response is taken to hold a whole close group of
+// contacts already in the table, and each contact is checked, added and has its key looked up.
+TEST(RoutingTableBenchmarkTest, FUNC_DuplicateAddStorm) {
+  const size_t kResponseCount(2000);
+  RoutingTable table(MakeIdentity());
+  auto nodes(MakeNodes(1000));
+  for (const auto& node : nodes)
+    table.AddNode(node);
+  std::vector<NodeInfo> held;
+  for (const auto& node : nodes) {
+    if (table.GetPublicKey(node.id))
+      held.push_back(node);
+  }
+  ASSERT_EQ(table.Size(), held.size());
+
+  const size_t kCalls(kResponseCount * GroupSize);
+  size_t added(0);
+  auto add_time(MicrosecondsPerCall(kCalls, [&] {
+    for (size_t i(0); i < kCalls; ++i)
+      added += table.AddNode(held[i % held.size()]).first ? 1 : 0;
+  }));
+  size_t checked(0);
+  auto check_time(MicrosecondsPerCall(kCalls, [&] {
+    for (size_t i(0); i < kCalls; ++i)
+      checked += table.CheckNode(held[i % held.size()].id) ? 1 : 0;
+  }));
+  size_t found(0);
+  auto key_time(MicrosecondsPerCall(kCalls, [&] {
+    for (size_t i(0); i < kCalls; ++i)
+      found += table.GetPublicKey(held[i % held.size()].id) ? 1 : 0;
+  }));
+  EXPECT_EQ(0U, added);
+  EXPECT_EQ(0U, checked);
+  EXPECT_EQ(kCalls, found);
+
+  std::cout << kResponseCount << " responses of " << GroupSize << " held contacts (table size "
+            << table.Size() << "):  duplicate AddNode " << add_time
+            << " us,  duplicate CheckNode " << check_time << " us,  GetPublicKey " << key_time
+            << " us\n";
+}
+
+// Runs 'reader_count' threads calling 'TargetNodes' for random targets while 'writer_count'
+// threads churn the table by dropping and re-adding held contacts, and reports the readers'
+// combined throughput.
+TEST(RoutingTableBenchmarkTest, FUNC_ConcurrentTargetNodes) {
+  const std::chrono::milliseconds kDuration(250);
+  auto nodes(MakeNodes(1000));
+  std::vector<Address> targets;
+  for (int i(0); i < 1000; ++i)
+    targets.push_back(MakeIdentity());
+
+  for (auto writer_count : {0, 1, 2}) {
+    for (auto reader_count : {1, 2, 4, 8}) {
+      RoutingTable table(MakeIdentity());
+      std::vector<NodeInfo> held;
+      for (const auto& node : nodes) {
+        if (table.AddNode(node).first)
+          held.push_back(node);
+      }
+
+      std::atomic<bool> stop(false);
+      std::atomic<size_t> reads(0), writes(0);
+      std::vector<std::thread> threads;
+      for (int i(0); i < writer_count; ++i) {
+        threads.emplace_back([&, i] {
+          size_t count(0);
+          for (size_t j(i); !stop; j += writer_count, ++count) {
+            const auto& node(held[j % held.size()]);
+            table.DropNode(node.id);
+            table.AddNode(node);
+          }
+          writes += count;
+        });
+      }
+      for (int i(0); i < reader_count; ++i) {
+        threads.emplace_back([&, i] {
+          size_t count(0);
+          for (size_t j(i); !stop; ++j, ++count)
+            EXPECT_FALSE(table.TargetNodes(targets[j % targets.size()]).empty());
+          reads += count;
+        });
+      }
+      std::this_thread::sleep_for(kDuration);
+      stop = true;
+      for (auto& thread : threads)
+        thread.join();
+
+      auto seconds(std::chrono::duration<double>(kDuration).count());
+      std::cout << writer_count << " writers, " << reader_count << " readers:  "
+                << static_cast<size_t>(reads / seconds) << " TargetNodes/s,  "
+                << static_cast<size_t>(writes / seconds) << " churns/s\n";
+    }
+  }
+}
+
+// Compares the copying 'TargetNodes' with the one filling a reused 'Targets', timing each and
+// counting the heap allocations they make per call.
+TEST(RoutingTableBenchmarkTest, FUNC_TargetNodesAllocations) {
+  const size_t kCalls(100000);
+  RoutingTable table(MakeIdentity());
+  for (const auto& node : MakeNodes(1000))
+    table.AddNode(node);
+  std::vector<Address> targets{table.OurId()};
+  for (int i(0); i < 999; ++i)
+    targets.push_back(MakeIdentity());
+
+  size_t found(0);
+  auto allocations_before(allocation_count.load());
+  auto copy_time(MicrosecondsPerCall(kCalls, [&] {
+    for (size_t i(0); i < kCalls; ++i)
+      found += table.TargetNodes(targets[i % targets.size()]).size();
+  }));
+  auto copy_allocations(allocation_count - allocations_before);
+
+  RoutingTable::Targets result;
+  allocations_before = allocation_count;
+  auto handle_time(MicrosecondsPerCall(kCalls, [&] {
+    for (size_t i(0); i < kCalls; ++i) {
+      table.TargetNodes(targets[i % targets.size()], result);
+      found -= result.size();
+    }
+  }));
+  auto handle_allocations(allocation_count - allocations_before);
+  EXPECT_EQ(0U, found);
+  EXPECT_EQ(0U, handle_allocations);
+
+  std::cout << "TargetNodes copying NodeInfos: " << copy_time << " us, "
+            << static_cast<double>(copy_allocations) / kCalls << " allocations per call\n"
+            << "TargetNodes filling Targets:   " << handle_time << " us, "
+            << static_cast<double>(handle_allocations) / kCalls << " allocations per call\n";
+}
+
+// Feeds 1k-contact batches into a table, comparing 'AddNodes' and 'DropNodes' with calling
+// 'AddNode' and 'DropNode' once per contact.
+TEST(RoutingTableBenchmarkTest, FUNC_BatchAddDrop) {
+  const size_t kBatchSize(1000), kBatchCount(20);
+  auto our_id(MakeIdentity());
+  std::vector<std::vector<NodeInfo>> batches;
+  for (size_t i(0); i < kBatchCount; ++i)
+    batches.push_back(MakeNodes(kBatchSize));
+
+  RoutingTable single_table(our_id);
+  auto single_add_time(MicrosecondsPerCall(kBatchCount, [&] {
+    for (const auto& batch : batches) {
+      for (const auto& node : batch)
+        single_table.AddNode(node);
+    }
+  }));
+
+  RoutingTable batch_table(our_id);
+  auto batch_add_time(MicrosecondsPerCall(kBatchCount, [&] {
+    for (const auto& batch : batches)
+      batch_table.AddNodes(batch);
+  }));
+  EXPECT_EQ(single_table.Size(), batch_table.Size());
+
+  std::vector<Address> to_drop;
+  for (const auto& batch : batches) {
+    for (const auto& node : batch)
+      to_drop.push_back(node.id);
+  }
+  to_drop.resize(kBatchSize);
+  std::vector<Address> held;
+  for (const auto& node : batch_table.OurCloseGroup())
+    held.push_back(node.id);
+  to_drop.insert(std::end(to_drop), std::begin(held), std::end(held));
+
+  auto single_drop_time(MicrosecondsPerCall(1, [&] {
+    for (const auto& id : to_drop)
+      single_table.DropNode(id);
+  }));
+  auto batch_drop_time(MicrosecondsPerCall(1, [&] { batch_table.DropNodes(to_drop); }));
+  EXPECT_EQ(single_table.Size(), batch_table.Size());
+
+  std::cout << "Per " << kBatchSize << "-contact batch:  AddNode x " << kBatchSize << " "
+            << single_add_time << " us, AddNodes " << batch_add_time << " us,  DropNode x "
+            << to_drop.size() << " " << single_drop_time << " us, DropNodes " << batch_drop_time
+            << " us\n";
+}
+
+// Churns a 2000-node network, where each step one random node leaves and a new one joins and is
+// offered to the table.  Each departure of a held contact would otherwise need a network lookup to
+// refill its place; this counts how many are instead refilled from the replacement caches by a
+// contact which is still alive (stale replacements are dropped in turn, as a failed connect would).
+TEST(RoutingTableBenchmarkTest, FUNC_ReplacementCacheChurn) {
+  const size_t kNetworkSize(2000), kChurnCount(20000);
+  RoutingTable table(MakeIdentity());
+  auto fob(PublicFob());
+  std::vector<Address> network;
+  std::set<Address> alive;
+  unsigned short port(0);
+  auto join([&] {
+    NodeInfo node(MakeIdentity(), fob, true);
+    network.push_back(node.id);
+    alive.insert(node.id);
+    table.AddNode(std::move(node),
+                  EndpointPair(EndpointPair::Endpoint(address_v4::loopback(), ++port)));
+  });
+  for (size_t i(0); i < kNetworkSize; ++i)
+    join();
+
+  std::mt19937 rng(RandomUint32());
+  size_t held_departures(0), refilled(0), stale(0);
+  auto churn_time(MicrosecondsPerCall(kChurnCount, [&] {
+    for (size_t i(0); i < kChurnCount; ++i) {
+      auto index(std::uniform_int_distribution<size_t>(0, network.size() - 1)(rng));
+      Address leaving(std::move(network[index]));
+      network[index] = std::move(network.back());
+      network.pop_back();
+      alive.erase(leaving);
+      if (table.GetPublicKey(leaving)) {
+        ++held_departures;
+        auto promoted(table.DropNode(leaving));
+        while (promoted && alive.count(promoted->node_info.id) == 0) {
+          ++stale;
+          promoted = table.DropNode(promoted->node_info.id);
+        }
+        if (promoted)
+          ++refilled;
+      }
+      join();
+    }
+  }));
+
+  std::cout << kChurnCount << " departures (" << held_departures << " held by the table, "
+            << churn_time << " us per churn step):  " << refilled
+            << " lookups saved by replacements, " << held_departures - refilled
+            << " lookups still needed, " << stale << " stale replacements discarded\n";
+}
+
+// Reports the L1 data cache read misses and time per call of 'AddNode' (streaming a 10k network
+// through the table) and 'TargetNodes' (filling a reused 'Targets' for random targets).
+TEST(RoutingTableBenchmarkTest, FUNC_CacheMisses) {
+  const size_t kTargetCount(100000);
+  CacheMissCounter counter;
+  RoutingTable table(MakeIdentity());
+  auto nodes(MakeNodes(10000));
+  std::vector<Address> targets;
+  for (int i(0); i < 1000; ++i)
+    targets.push_back(MakeIdentity());
+
+  uint64_t add_misses(0);
+  auto add_time(MicrosecondsPerCall(nodes.size(), [&] {
+    add_misses = counter.Count([&] {
+      for (auto& node : nodes)
+        table.AddNode(std::move(node));
+    });
+  }));
+  RoutingTable::Targets result;
+  uint64_t target_misses(0);
+  auto target_time(MicrosecondsPerCall(kTargetCount, [&] {
+    target_misses = counter.Count([&] {
+      for (size_t i(0); i < kTargetCount; ++i)
+        table.TargetNodes(targets[i % targets.size()], result);
+    });
+  }));
+
+  if (!counter.Available())
+    std::cout << "Hardware cache counters unavailable, reporting timings only\n";
+  std::cout << "AddNode:      " << add_time << " us, "
+            << static_cast<double>(add_misses) / nodes.size() << " L1D read misses per call\n"
+            << "TargetNodes:  " << target_time << " us, "
+            << static_cast<double>(target_misses) / kTargetCount << " L1D read misses per call\n";
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -18,12 +18,15 @@
 
 #include "maidsafe/routing/routing_table.h"
 
+#include <map>
 #include <random>
+#include <vector>
 
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
 
 #include "maidsafe/routing/tests/utils/routing_table_unit_test.h"
+#include "maidsafe/routing/tests/utils/test_utils.h"
 
 namespace maidsafe {
 
@@ -64,6 +67,86 @@ TEST_F(RoutingTableUnitTest, BEH_DropNode) {
   }
 }
 
+TEST(RoutingTableDropNodeTest, BEH_PromoteReplacement) {
+  RoutingTable table(MakeIdentity());
+  auto fob(PublicFob());
+  // the contacts offered but not added, in order of being offered, by bucket
+  std::map<int32_t, std::vector<RoutingTable::Replacement>> rejected;
+  std::vector<Address> accepted;
+  for (unsigned short port(1000); port < 1500; ++port) {
+    NodeInfo node(MakeIdentity(), fob, true);
+    EndpointPair endpoints(EndpointPair::Endpoint(address_v4::loopback(), port));
+    if (table.AddNode(node, endpoints).first)
+      accepted.push_back(node.id);
+    else
+      rejected[table.BucketIndex(node.id)].push_back(RoutingTable::Replacement{node, endpoints});
+  }
+  ASSERT_EQ(RoutingTable::OptimalSize(), table.Size());
+
+  // find a held contact in a bucket which has replacements
+  Address held;
+  for (const auto& id : accepted) {
+    if (table.GetPublicKey(id) && rejected.count(table.BucketIndex(id)) != 0) {
+      held = id;
+      break;
+    }
+  }
+  ASSERT_TRUE(held.IsInitialised());
+  auto& replacements(rejected[table.BucketIndex(held)]);
+
+  // dropping it promotes the most recently offered replacement, along with its endpoints
+  auto promoted(table.DropNode(held));
+  ASSERT_TRUE(promoted);
+  EXPECT_EQ(replacements.back().node_info.id, promoted->node_info.id);
+  EXPECT_EQ(replacements.back().endpoint_pair, promoted->endpoint_pair);
+  EXPECT_TRUE(table.GetPublicKey(promoted->node_info.id));
+  EXPECT_EQ(RoutingTable::OptimalSize(), table.Size());
+  replacements.pop_back();
+
+  // dropping replacements which aren't held removes them from the cache, so dropping the promoted
+  // contact takes a replacement from the closest other bucket
+  for (const auto& replacement : replacements)
+    EXPECT_FALSE(table.DropNode(replacement.node_info.id));
+  rejected.erase(table.BucketIndex(held));
+  EXPECT_EQ(RoutingTable::OptimalSize(), table.Size());
+  auto next_promoted(table.DropNode(promoted->node_info.id));
+  if (rejected.empty()) {
+    EXPECT_FALSE(next_promoted);
+    EXPECT_EQ(RoutingTable::OptimalSize() - 1, table.Size());
+  } else {
+    ASSERT_TRUE(next_promoted);
+    EXPECT_EQ(rejected.rbegin()->second.back().node_info.id, next_promoted->node_info.id);
+    EXPECT_EQ(RoutingTable::OptimalSize(), table.Size());
+  }
+}
+
+// A contact offered without endpoints can't be connected to, so mustn't be cached for promotion.
+TEST(RoutingTableDropNodeTest, BEH_NoReplacementWithoutEndpoints) {
+  RoutingTable table(MakeIdentity());
+  auto fob(PublicFob());
+  std::vector<NodeInfo> batch;
+  std::vector<Address> accepted;
+  for (int i(0); i < 500; ++i) {
+    NodeInfo node(MakeIdentity(), fob, true);
+    if (i % 2 == 0)
+      batch.push_back(node);
+    else if (table.AddNode(node).first)
+      accepted.push_back(node.id);
+  }
+  auto result(table.AddNodes(batch));
+  accepted.insert(accepted.end(), result.added.begin(), result.added.end());
+  ASSERT_EQ(RoutingTable::OptimalSize(), table.Size());
+
+  auto size(table.Size());
+  for (const auto& id : accepted) {
+    if (!table.GetPublicKey(id))
+      continue;
+    EXPECT_FALSE(table.DropNode(id));
+    EXPECT_EQ(--size, table.Size());
+  }
+  EXPECT_EQ(0, table.Size());
+}
+
 }  // namespace test
 
 }  // namespace routing
@@ -108,6 +108,37 @@ TEST_F(RoutingTableUnitTest, BEH_TargetNodes) {
   }
 }
 
+TEST_F(RoutingTableUnitTest, BEH_TargetNodesHandles) {
+  RoutingTable::Targets targets;
+  table_.TargetNodes(MakeIdentity(), targets);
+  EXPECT_TRUE(targets.empty());
+
+  PartiallyFillTable();
+  CompleteFillingTable();
+
+  std::vector<Address> targets_to_try{table_.OurId()};
+  for (const auto& bucket : buckets_) {
+    targets_to_try.push_back(bucket.far_contact);
+    targets_to_try.push_back(bucket.mid_contact);
+  }
+  for (const auto& target : targets_to_try) {
+    auto target_nodes(table_.TargetNodes(target));
+    table_.TargetNodes(target, targets);
+    ASSERT_EQ(target_nodes.size(), targets.size());
+    for (size_t i = 0; i < targets.size(); ++i)
+      EXPECT_EQ(target_nodes[i].id, targets[i].id);
+  }
+
+  // The handles stay valid after the contacts are dropped from the table
+  table_.TargetNodes(table_.OurId(), targets);
+  ASSERT_EQ(GroupSize, targets.size());
+  for (const auto& id : added_ids_)
+    table_.DropNode(id);
+  EXPECT_EQ(0U, table_.Size());
+  for (size_t i = 0; i < targets.size(); ++i)
+    EXPECT_EQ(buckets_[RoutingTable::OptimalSize() - 1 - i].mid_contact, targets[i].id);
+}
+
 }  // namespace test
 
 }  // namespace routing
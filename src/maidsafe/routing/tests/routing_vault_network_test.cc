@@ -17,7 +17,10 @@
     use of the MaidSafe Software.                                                                 */
 
 
+#include <atomic>
 #include <chrono>
+#include <set>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -38,6 +41,7 @@
 #include "maidsafe/routing/routing_node.h"
 #include "maidsafe/routing/bootstrap_handler.h"
 #include "maidsafe/routing/types.h"
+#include "maidsafe/routing/tests/utils/routing_node_test_access.h"
 #include "maidsafe/routing/tests/utils/test_utils.h"
 
 namespace maidsafe {
@@ -127,7 +131,7 @@ class MaidManager {
             LOG(kWarning) << "could not send from MiadManager (Put)";
         });
   }
-  void HandleChurn(CloseGroupDifference) {
+  void HandleChurn(CloseGroupChange) {
     // send all account info to the group of each name and delete it - wait for refreshed accounts
   }
 };
@@ -143,7 +147,7 @@ class DataManager {
   }
   template <typename T>
   void HandlePut(SourceAddress /* from */, Identity /* data_name */, DataType /* data */) {}
-  void HandleChurn(CloseGroupDifference) {
+  void HandleChurn(CloseGroupChange) {
     // send all account info to the group of each name and delete it - wait for refreshed accounts
   }
 };
@@ -168,7 +172,7 @@ class PmidManager {
   }
   template <typename T>
   void HandlePut(SourceAddress /* from */, Identity /* data_name */, DataType /* data */) {}
-  void HandleChurn(CloseGroupDifference) {
+  void HandleChurn(CloseGroupChange) {
     // send all account info to the group of each name and delete it - wait for refreshed accounts
   }
 };
@@ -273,7 +277,7 @@ class VaultFacade : public test::MaidManager<VaultFacade>,
   void HandleConnectionAdded(Address) {
   }
 
-  void HandleChurn(CloseGroupDifference diff) {
+  void HandleChurn(CloseGroupChange diff) {
     MaidManager::HandleChurn(diff);
     DataManager::HandleChurn(diff);
     PmidManager::HandleChurn(diff);
@@ -310,6 +314,58 @@ TEST(VaultNetworkTest, FUNC_CreateNetPutGetData) {
   // n.Put<MutableData>(to, a, [](asio::error_code /* error */) {});
 }
 
+// Puts from several threads are serialised with the peer churn on the control shard.
+TEST(VaultNetworkTest, BEH_ConcurrentPutWhileChurning) {
+  RoutingNode<VaultFacade> n;
+  const auto fob(PublicFob());
+  std::vector<Address> peers;
+  for (int i(0); i < 32; ++i) {
+    peers.push_back(MakeIdentity());
+    RoutingNodeAccess::Connect(n, NodeInfo(peers.back(), fob, true));
+  }
+
+  RoutingNodeAccess::Flush(n);
+  const auto tasks_run(RoutingNodeAccess::ControlTasksRun(n));
+
+  const int kPutters(4), kPutsEach(200), kChurnSteps(200);
+  ImmutableData data(NonEmptyString(RandomAlphaNumericBytes(65)));
+  Address to(MakeIdentity());
+  // Put handlers run on the control shard; there's always a peer to send to, so none should fail.
+  std::atomic<int> puts_completed(0), puts_failed(0);
+  std::vector<std::thread> putters;
+  for (int i(0); i < kPutters; ++i) {
+    putters.emplace_back([&] {
+      for (int j(0); j < kPutsEach; ++j) {
+        n.Put<ImmutableData>(to, data, [&](asio::error_code error) {
+          ++puts_completed;
+          if (error)
+            ++puts_failed;
+        });
+      }
+    });
+  }
+  std::set<Address> connected(peers.begin(), peers.end());
+  for (int i(0); i < kChurnSteps; ++i) {
+    const auto& leaving(peers[i % peers.size()]);
+    const auto& joining(peers[(i + 7) % peers.size()]);
+    RoutingNodeAccess::Drop(n, leaving);
+    RoutingNodeAccess::Connect(n, NodeInfo(joining, fob, true));
+    connected.erase(leaving);
+    connected.insert(joining);
+  }
+  for (auto& putter : putters)
+    putter.join();
+  RoutingNodeAccess::Flush(n);
+
+  EXPECT_EQ(kPutters * kPutsEach, puts_completed);
+  EXPECT_EQ(0, puts_failed);
+  for (const auto& peer : peers)
+    EXPECT_EQ(connected.count(peer) != 0, RoutingNodeAccess::IsConnected(n, peer));
+  // Every Put and churn step ran as its own task on the control shard.
+  EXPECT_GE(RoutingNodeAccess::ControlTasksRun(n) - tasks_run,
+            static_cast<uint64_t>(kPutters * kPutsEach + 2 * kChurnSteps));
+}
+
 
 }  // namespace test
 
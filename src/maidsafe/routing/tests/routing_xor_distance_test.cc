@@ -0,0 +1,185 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/xor_distance.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// Returns a copy of 'id' which shares exactly 'common_bits' leading bits with it.
+Address FlipBit(const Address& id, size_t common_bits) {
+  std::string bytes(id.string());
+  bytes[common_bits / 8] ^= static_cast<char>(0x80 >> (common_bits % 8));
+  return Address(bytes);
+}
+
+std::vector<Address> MakeIds(size_t count) {
+  std::vector<Address> ids;
+  ids.reserve(count);
+  for (size_t i(0); i < count; ++i)
+    ids.push_back(MakeIdentity());
+  return ids;
+}
+
+template <typename Function>
+double NanosecondsPerCall(size_t calls, Function function) {
+  auto start(std::chrono::steady_clock::now());
+  function();
+  auto elapsed(std::chrono::steady_clock::now() - start);
+  return std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+}
+
+}  // unnamed namespace
+
+TEST(XorDistanceTest, BEH_CommonLeadingBits) {
+  auto id(MakeIdentity());
+  EXPECT_EQ(static_cast<int32_t>(identity_size * 8), XorCommonLeadingBits(id, id));
+  for (size_t bits(0); bits < identity_size * 8; ++bits) {
+    auto other(FlipBit(id, bits));
+    EXPECT_EQ(CommonLeadingBits(id, other), XorCommonLeadingBits(id, other));
+    EXPECT_EQ(static_cast<int32_t>(bits), XorCommonLeadingBits(other, id));
+  }
+  auto ids(MakeIds(1000));
+  for (size_t i(1); i < ids.size(); ++i)
+    EXPECT_EQ(CommonLeadingBits(ids[i - 1], ids[i]), XorCommonLeadingBits(ids[i - 1], ids[i]));
+}
+
+TEST(XorDistanceTest, BEH_Closer) {
+  auto target(MakeIdentity());
+  EXPECT_FALSE(XorCloser(target, target, target));
+  for (size_t bits(0); bits < identity_size * 8; ++bits) {
+    auto lhs(FlipBit(target, bits)), rhs(FlipBit(lhs, identity_size * 8 - 1));
+    EXPECT_EQ(CloserToTarget(lhs, rhs, target), XorCloser(lhs, rhs, target));
+    EXPECT_EQ(CloserToTarget(rhs, lhs, target), XorCloser(rhs, lhs, target));
+    EXPECT_FALSE(XorCloser(lhs, lhs, target));
+  }
+  auto ids(MakeIds(1000));
+  for (size_t i(1); i < ids.size(); ++i)
+    EXPECT_EQ(CloserToTarget(ids[i - 1], ids[i], target), XorCloser(ids[i - 1], ids[i], target));
+}
+
+TEST(XorDistanceTest, BEH_Distances) {
+  auto target(MakeIdentity());
+  auto ids(MakeIds(100));
+  ids.push_back(target);
+  ids.push_back(FlipBit(target, identity_size * 8 - 1));
+  std::vector<byte> packed;
+  for (const auto& id : ids)
+    packed.insert(std::end(packed), AddressBytes(id), AddressBytes(id) + identity_size);
+  std::vector<XorDistance> distances(ids.size());
+  XorDistances(AddressBytes(target), packed.data(), ids.size(), distances.data());
+
+  EXPECT_EQ(XorDistance(), distances[ids.size() - 2]);
+  XorDistance one{{0, 0, 0, 0, 0, 0, 0, 1}};
+  EXPECT_EQ(one, distances.back());
+  for (size_t i(0); i < ids.size(); ++i) {
+    for (size_t j(0); j < ids.size(); ++j) {
+      EXPECT_EQ(CloserToTarget(ids[i], ids[j], target), distances[i] < distances[j]);
+    }
+  }
+}
+
+// Compares the kernels with the scalar 'CloserToTarget' and 'CommonLeadingBits' they replace, both
+// for random pairs and for pairs sharing long prefixes (as close group members do), and compares
+// ordering a table by closeness to a target via 'XorDistances' against sorting with
+// 'CloserToTarget'.
+TEST(XorDistanceTest, FUNC_Benchmark) {
+  const size_t kCalls(1000000);
+  auto target(MakeIdentity());
+  auto ids(MakeIds(1024));
+  std::vector<Address> close_ids;
+  for (size_t i(0); i < ids.size(); ++i)
+    close_ids.push_back(FlipBit(target, 400 + i % 100));
+
+  for (const auto* pairs : {&ids, &close_ids}) {
+    const auto& set(*pairs);
+    size_t count(0);
+    auto scalar_closer(NanosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i)
+        count += CloserToTarget(set[i % set.size()], set[(i + 1) % set.size()], target) ? 1 : 0;
+    }));
+    auto simd_closer(NanosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i)
+        count -= XorCloser(set[i % set.size()], set[(i + 1) % set.size()], target) ? 1 : 0;
+    }));
+    int64_t bits(0);
+    auto scalar_bits(NanosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i)
+        bits += CommonLeadingBits(target, set[i % set.size()]);
+    }));
+    auto simd_bits(NanosecondsPerCall(kCalls, [&] {
+      for (size_t i(0); i < kCalls; ++i)
+        bits -= XorCommonLeadingBits(target, set[i % set.size()]);
+    }));
+    EXPECT_EQ(0U, count);
+    EXPECT_EQ(0, bits);
+    std::cout << (pairs == &ids ? "Random" : "Close") << " addresses:  CloserToTarget "
+              << scalar_closer << " ns, XorCloser " << simd_closer << " ns,  CommonLeadingBits "
+              << scalar_bits << " ns, XorCommonLeadingBits " << simd_bits << " ns\n";
+  }
+
+  const size_t kSorts(1000);
+  std::vector<byte> packed;
+  for (const auto& id : ids)
+    packed.insert(std::end(packed), AddressBytes(id), AddressBytes(id) + identity_size);
+  std::vector<size_t> scalar_order(ids.size()), order(ids.size());
+  auto scalar_sort(NanosecondsPerCall(kSorts, [&] {
+    for (size_t i(0); i < kSorts; ++i) {
+      for (size_t j(0); j < scalar_order.size(); ++j)
+        scalar_order[j] = j;
+      std::sort(std::begin(scalar_order), std::end(scalar_order), [&](size_t lhs, size_t rhs) {
+        return CloserToTarget(ids[lhs], ids[rhs], target);
+      });
+    }
+  }));
+  std::vector<XorDistance> distances(ids.size());
+  auto batch_sort(NanosecondsPerCall(kSorts, [&] {
+    for (size_t i(0); i < kSorts; ++i) {
+      XorDistances(AddressBytes(target), packed.data(), ids.size(), distances.data());
+      for (size_t j(0); j < order.size(); ++j)
+        order[j] = j;
+      std::sort(std::begin(order), std::end(order),
+                [&](size_t lhs, size_t rhs) { return distances[lhs] < distances[rhs]; });
+    }
+  }));
+  EXPECT_EQ(scalar_order, order);
+  std::cout << "Ordering " << ids.size() << " addresses by distance:  CloserToTarget sort "
+            << scalar_sort / 1000 << " us, XorDistances sort " << batch_sort / 1000 << " us\n";
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
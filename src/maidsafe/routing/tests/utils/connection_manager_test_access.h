@@ -0,0 +1,68 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TESTS_UTILS_CONNECTION_MANAGER_TEST_ACCESS_H_
+#define MAIDSAFE_ROUTING_TESTS_UTILS_CONNECTION_MANAGER_TEST_ACCESS_H_
+
+#include <memory>
+
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/crux/socket.hpp"
+
+#include "maidsafe/routing/connection_manager.h"
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/peer_node.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+// Gives tests the peers of a connection manager directly, without any networking.  A peer added
+// here has an unopened socket.
+struct ConnectionManagerAccess {
+  // Stores the peer without consulting the routing table or receiving from it, so the io_service
+  // needn't be run.
+  template <typename Manager>
+  static void AddPeer(Manager& manager, NodeInfo node_info) {
+    auto socket(std::make_shared<crux::socket>(manager.io_service_));
+    manager.StorePeer(maidsafe::make_unique<PeerNode>(std::move(node_info), std::move(socket)));
+    manager.UpdateCloseGroupRadius();
+  }
+
+  // Offers the peer as if it had just connected, returning its socket (which expires if the peer
+  // isn't kept, or is later dropped).  A peer which connected to us has no endpoints.
+  template <typename Manager>
+  static std::weak_ptr<crux::socket> Connect(Manager& manager, NodeInfo node_info,
+                                             EndpointPair endpoint_pair = EndpointPair()) {
+    auto socket(std::make_shared<crux::socket>(manager.io_service_));
+    std::weak_ptr<crux::socket> result(socket);
+    manager.InsertPeer(maidsafe::make_unique<PeerNode>(std::move(node_info), std::move(socket),
+                                                       std::move(endpoint_pair)));
+    return result;
+  }
+};
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TESTS_UTILS_CONNECTION_MANAGER_TEST_ACCESS_H_
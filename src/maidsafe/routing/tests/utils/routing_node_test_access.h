@@ -0,0 +1,80 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TESTS_UTILS_ROUTING_NODE_TEST_ACCESS_H_
+#define MAIDSAFE_ROUTING_TESTS_UTILS_ROUTING_NODE_TEST_ACCESS_H_
+
+#include <cstdint>
+#include <future>
+
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/routing_node.h"
+#include "maidsafe/routing/types.h"
+#include "maidsafe/routing/tests/utils/connection_manager_test_access.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+// Lets tests change the peers of a routing node, without any networking.  Each call is made on the
+// node's control shard, as the node's own calls are.
+struct RoutingNodeAccess {
+  template <typename Child>
+  static void Connect(RoutingNode<Child>& node, NodeInfo node_info) {
+    node.io_shards_.Control().Post([&node, node_info]() {
+      ConnectionManagerAccess::Connect(node.connection_manager_, node_info);
+    });
+  }
+
+  template <typename Child>
+  static void Drop(RoutingNode<Child>& node, Address id) {
+    node.io_shards_.Control().Post([&node, id]() { node.connection_manager_.DropNode(id); });
+  }
+
+  // Blocks until everything already posted to the control shard has run.
+  template <typename Child>
+  static void Flush(RoutingNode<Child>& node) {
+    std::promise<void> done;
+    node.io_shards_.Control().Post([&done]() { done.set_value(); });
+    done.get_future().get();
+  }
+
+  template <typename Child>
+  static bool IsConnected(RoutingNode<Child>& node, Address id) {
+    std::promise<bool> connected;
+    node.io_shards_.Control().Post([&node, &connected, id]() {
+      connected.set_value(node.connection_manager_.IsManaged(id));
+    });
+    return connected.get_future().get();
+  }
+
+  template <typename Child>
+  static uint64_t ControlTasksRun(RoutingNode<Child>& node) {
+    return node.io_shards_.Control().TasksRun();
+  }
+};
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TESTS_UTILS_ROUTING_NODE_TEST_ACCESS_H_
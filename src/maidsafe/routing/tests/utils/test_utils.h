@@ -37,7 +37,9 @@ namespace maidsafe {
 namespace routing {
 
 class MessageHeader;
-class RoutingTable;
+template <typename NetworkParameters>
+class BasicRoutingTable;
+using RoutingTable = BasicRoutingTable<DefaultNetworkParameters>;
 
 namespace test {
 
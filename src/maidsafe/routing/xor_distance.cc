@@ -0,0 +1,74 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/xor_distance.h"
+
+#include <cstring>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+#if !defined(__AVX2__)
+uint64_t LoadBigEndian(const byte* bytes) {
+  uint64_t result;
+  std::memcpy(&result, bytes, sizeof(result));
+#if defined(_MSC_VER)
+  return _byteswap_uint64(result);
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return result;
+#else
+  return __builtin_bswap64(result);
+#endif
+}
+#endif
+
+}  // unnamed namespace
+
+void XorDistances(const byte* target, const byte* ids, size_t count, XorDistance* distances) {
+#if defined(__AVX2__)
+  // reverses the bytes of each 64-bit lane
+  const auto reverse(_mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6,
+                                      5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+  const auto target_low(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(target)));
+  const auto target_high(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(target + 32)));
+  for (size_t i(0); i < count; ++i, ids += identity_size) {
+    auto low(_mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids)),
+                              target_low));
+    auto high(_mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + 32)),
+                               target_high));
+    auto distance(reinterpret_cast<__m256i*>(distances[i].data()));
+    _mm256_storeu_si256(distance, _mm256_shuffle_epi8(low, reverse));
+    _mm256_storeu_si256(distance + 1, _mm256_shuffle_epi8(high, reverse));
+  }
+#else
+  XorDistance target_words;
+  for (size_t word(0); word < target_words.size(); ++word)
+    target_words[word] = LoadBigEndian(target + word * 8);
+  for (size_t i(0); i < count; ++i, ids += identity_size) {
+    for (size_t word(0); word < target_words.size(); ++word)
+      distances[i][word] = LoadBigEndian(ids + word * 8) ^ target_words[word];
+  }
+#endif
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,204 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_XOR_DISTANCE_H_
+#define MAIDSAFE_ROUTING_XOR_DISTANCE_H_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MAIDSAFE_ROUTING_XOR_DISTANCE_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/routing/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Kernels for the XOR metric on raw 64-byte addresses.  They give the same results as
+// 'CloserToTarget' and 'CommonLeadingBits', but compare 32 (AVX2) or 16 (SSE2) bytes per step to
+// find the first byte which decides the answer.  The instruction set is chosen at compile time;
+// if neither is enabled, a scalar fallback is used.
+
+static_assert(identity_size == 64, "The XOR kernels assume 64-byte addresses.");
+
+// The distance between two addresses as eight big-endian words, so that distances can be compared
+// as plain integers (std::array's lexicographical operator< gives closeness order).
+using XorDistance = std::array<uint64_t, 8>;
+
+// The raw bytes of an address, held inline rather than on the heap.  Arrays of these are dense, so
+// ordering and searching them touches as few cache lines as possible.
+using RawAddress = std::array<byte, identity_size>;
+static_assert(sizeof(RawAddress) == identity_size, "RawAddress arrays must be dense.");
+
+inline const byte* AddressBytes(const Address& address) {
+  return reinterpret_cast<const byte*>(address.string().data());
+}
+
+inline RawAddress ToRawAddress(const Address& address) {
+  RawAddress raw_address;
+  std::copy(AddressBytes(address), AddressBytes(address) + identity_size, raw_address.begin());
+  return raw_address;
+}
+
+// As 'AddressHash', for RawAddress.
+struct RawAddressHash {
+  size_t operator()(const RawAddress& address) const {
+    size_t result(0);
+    std::memcpy(&result, address.data(), sizeof(result));
+    return result;
+  }
+};
+
+namespace detail {
+
+inline uint32_t CountTrailingZeros(uint32_t value) {
+  assert(value != 0);
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+}
+
+inline int32_t CountLeadingZeros(byte value) {
+  assert(value != 0);
+  int32_t count(0);
+  for (; (value & 0x80) == 0; value = static_cast<byte>(value << 1))
+    ++count;
+  return count;
+}
+
+inline int32_t CountLeadingZeros64(uint64_t value) {
+  assert(value != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return 63 - static_cast<int32_t>(index);
+#elif defined(_MSC_VER)
+  int32_t count(0);
+  for (; (value & (1ULL << 63)) == 0; value <<= 1)
+    ++count;
+  return count;
+#else
+  return static_cast<int32_t>(__builtin_clzll(value));
+#endif
+}
+
+// Returns the index of the first byte at which 'lhs' and 'rhs' differ, or 'identity_size' if they
+// are equal.
+inline size_t FirstDifference(const byte* lhs, const byte* rhs) {
+#if defined(__AVX2__)
+  for (size_t i(0); i < identity_size; i += 32) {
+    auto equal(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i)),
+                                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i))));
+    auto mask(~static_cast<uint32_t>(_mm256_movemask_epi8(equal)));
+    if (mask != 0)
+      return i + CountTrailingZeros(mask);
+  }
+#elif defined(MAIDSAFE_ROUTING_XOR_DISTANCE_SSE2)
+  for (size_t i(0); i < identity_size; i += 16) {
+    auto equal(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i)),
+                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i))));
+    auto mask(~static_cast<uint32_t>(_mm_movemask_epi8(equal)) & 0xFFFF);
+    if (mask != 0)
+      return i + CountTrailingZeros(mask);
+  }
+#else
+  for (size_t i(0); i < identity_size; ++i) {
+    if (lhs[i] != rhs[i])
+      return i;
+  }
+#endif
+  return identity_size;
+}
+
+}  // namespace detail
+
+// Equivalent to 'CloserToTarget(lhs, rhs, target)'.
+inline bool XorCloser(const byte* lhs, const byte* rhs, const byte* target) {
+  // The first byte where 'lhs' and 'rhs' differ is also the first where their distances differ.
+  auto i(detail::FirstDifference(lhs, rhs));
+  return i != identity_size && (lhs[i] ^ target[i]) < (rhs[i] ^ target[i]);
+}
+
+inline bool XorCloser(const Address& lhs, const Address& rhs, const Address& target) {
+  return XorCloser(AddressBytes(lhs), AddressBytes(rhs), AddressBytes(target));
+}
+
+// Equivalent to 'CommonLeadingBits(lhs, rhs)'.
+inline int32_t XorCommonLeadingBits(const byte* lhs, const byte* rhs) {
+  auto i(detail::FirstDifference(lhs, rhs));
+  if (i == identity_size)
+    return static_cast<int32_t>(identity_size * 8);
+  return static_cast<int32_t>(i * 8) + detail::CountLeadingZeros(lhs[i] ^ rhs[i]);
+}
+
+inline int32_t XorCommonLeadingBits(const Address& lhs, const Address& rhs) {
+  return XorCommonLeadingBits(AddressBytes(lhs), AddressBytes(rhs));
+}
+
+// Writes the distance to 'target' of each of the 'count' addresses held contiguously in 'ids' to
+// the corresponding element of 'distances'.
+void XorDistances(const byte* target, const byte* ids, size_t count, XorDistance* distances);
+
+inline XorDistance XorDistanceBetween(const Address& lhs, const Address& rhs) {
+  XorDistance distance;
+  XorDistances(AddressBytes(lhs), AddressBytes(rhs), 1, &distance);
+  return distance;
+}
+
+// As 'XorCloser' and 'XorCommonLeadingBits', but for addresses given as their distances from some
+// other address (as XOR with that address preserves both closeness and common prefixes).
+inline bool XorCloser(const XorDistance& lhs, const XorDistance& rhs, const XorDistance& target) {
+  for (size_t i(0); i < lhs.size(); ++i) {
+    if (lhs[i] != rhs[i])
+      return (lhs[i] ^ target[i]) < (rhs[i] ^ target[i]);
+  }
+  return false;
+}
+
+inline int32_t XorCommonLeadingBits(const XorDistance& lhs, const XorDistance& rhs) {
+  for (size_t i(0); i < lhs.size(); ++i) {
+    if (lhs[i] != rhs[i])
+      return static_cast<int32_t>(i * 64) + detail::CountLeadingZeros64(lhs[i] ^ rhs[i]);
+  }
+  return static_cast<int32_t>(identity_size * 8);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_XOR_DISTANCE_H_